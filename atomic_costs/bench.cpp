@@ -0,0 +1,118 @@
+#include "cpu_utils.h"
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr size_t kMaxThreads = 256;
+
+const int kMaxBenchThreads =
+    static_cast<int>(std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), kMaxThreads));
+
+enum class Op { Cas, FetchAdd, Exchange, StoreSeqCst, StoreRelease };
+
+// Where the variables of the threads live: one variable for all of them, one per thread packed next to each
+// other (false sharing), or one per thread on its own cache line.
+enum class Layout { Shared, Packed, Padded };
+
+struct alignas(kCacheLineSize) PaddedAtomic {
+    std::atomic<uint64_t> val;
+};
+
+alignas(kCacheLineSize) std::atomic<uint64_t> shared_var;
+alignas(kCacheLineSize) std::atomic<uint64_t> packed_vars[kMaxThreads];
+PaddedAtomic padded_vars[kMaxThreads];
+
+template <Layout L>
+std::atomic<uint64_t>& variable(size_t thread) {
+    if constexpr (L == Layout::Shared) {
+        return shared_var;
+    } else if constexpr (L == Layout::Packed) {
+        return packed_vars[thread];
+    } else {
+        return padded_vars[thread].val;
+    }
+}
+
+// Performs the operation once and returns the number of failed CAS attempts. The CAS is an increment loop with
+// the default seq_cst order, the way LockFreeRingBuffer updates its single state word.
+template <Op O>
+uint64_t apply(std::atomic<uint64_t>& var, uint64_t val) {
+    if constexpr (O == Op::Cas) {
+        uint64_t failures = 0;
+        uint64_t expected = var.load(std::memory_order_relaxed);
+        while (!var.compare_exchange_weak(expected, expected + 1)) {
+            ++failures;
+        }
+        return failures;
+    } else if constexpr (O == Op::FetchAdd) {
+        benchmark::DoNotOptimize(var.fetch_add(1));
+    } else if constexpr (O == Op::Exchange) {
+        benchmark::DoNotOptimize(var.exchange(val));
+    } else if constexpr (O == Op::StoreSeqCst) {
+        var.store(val, std::memory_order_seq_cst);
+    } else {
+        var.store(val, std::memory_order_release);
+    }
+    return 0;
+}
+
+} // namespace
+
+// Every benchmark thread applies the operation to its variable in a loop, with the threads placed as
+// state.range(0). items_per_second is the total over all threads, cas_failures the failed attempts per CAS.
+template <Op O, Layout L>
+void bench_atomic(benchmark::State& state) {
+    const auto placement = static_cast<Placement>(state.range(0));
+    const auto cpus = pick_cpus(state.threads(), placement);
+    if (!cpus) {
+        state.SkipWithError((std::string(placement_name(placement)) + " placement is not available").c_str());
+        return;
+    }
+    const ScopedPin pin((*cpus)[state.thread_index()]);
+    auto& var = variable<L>(state.thread_index());
+    uint64_t val = state.thread_index();
+    uint64_t failures = 0;
+    PerfCounters perf;
+    perf.start();
+    for (auto _ : state) {
+        failures += apply<O>(var, ++val);
+    }
+    perf.report(state);
+    state.SetLabel(placement_name(placement));
+    state.SetItemsProcessed(state.iterations());
+    if constexpr (O == Op::Cas) {
+        state.counters["cas_failures"] = benchmark::Counter(static_cast<double>(failures), benchmark::Counter::kAvgIterations);
+    }
+}
+
+void placement_args(benchmark::internal::Benchmark* b) {
+    b->DenseRange(static_cast<int>(Placement::SameCore), static_cast<int>(Placement::CrossSocket))
+        ->ArgName("placement")->ThreadRange(1, kMaxBenchThreads)->UseRealTime();
+}
+
+BENCHMARK(bench_atomic<Op::Cas, Layout::Shared>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::Cas, Layout::Packed>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::Cas, Layout::Padded>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::FetchAdd, Layout::Shared>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::FetchAdd, Layout::Packed>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::FetchAdd, Layout::Padded>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::Exchange, Layout::Shared>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::Exchange, Layout::Packed>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::Exchange, Layout::Padded>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::StoreSeqCst, Layout::Shared>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::StoreSeqCst, Layout::Packed>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::StoreSeqCst, Layout::Padded>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::StoreRelease, Layout::Shared>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::StoreRelease, Layout::Packed>)->Apply(placement_args);
+BENCHMARK(bench_atomic<Op::StoreRelease, Layout::Padded>)->Apply(placement_args);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#endif
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Alignment that keeps independently written variables on separate cache lines, so they do not false-share.
+inline constexpr size_t kCacheLineSize = 64;
+
+// Tells the core that we are in a spin loop: frees pipeline resources for the SMT sibling and avoids the
+// memory-order mis-speculation penalty when the awaited cache line finally changes.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Pins the calling thread to `cpu` and restores its previous affinity when destroyed, so the same helper serves
+// worker threads pinned for their whole life and a benchmark that pins the main thread for one run. A negative
+// cpu leaves the thread unpinned. Does nothing outside Linux.
+class ScopedPin {
+public:
+    explicit ScopedPin(int cpu) {
+#ifdef __linux__
+        if (cpu >= 0 && pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        }
+#endif
+    }
+    ScopedPin(const ScopedPin&) = delete;
+    ScopedPin& operator=(const ScopedPin&) = delete;
+    ~ScopedPin() {
+#ifdef __linux__
+        if (pinned) {
+            pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+        }
+#endif
+    }
+private:
+#ifdef __linux__
+    cpu_set_t saved;
+#endif
+    bool pinned = false;
+};
+
+// Where a group of pinned threads runs relative to each other.
+enum class Placement {
+    SameCore,    // SMT siblings of one physical core (one logical CPU if there is no SMT)
+    CrossCore,   // different physical cores of one socket
+    CrossSocket, // alternating between sockets
+};
+
+inline const char* placement_name(Placement placement) {
+    switch (placement) {
+    case Placement::SameCore: return "same-core";
+    case Placement::CrossCore: return "cross-core";
+    case Placement::CrossSocket: return "cross-socket";
+    }
+    return "";
+}
+
+// Logical CPUs this process may run on, grouped as socket -> physical core -> SMT siblings. Read from sysfs
+// on Linux, empty elsewhere (threads then stay unpinned).
+using CpuTopology = std::map<int, std::map<int, std::vector<int>>>;
+
+inline CpuTopology read_cpu_topology() {
+    CpuTopology topology;
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return topology;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &allowed)) {
+            continue;
+        }
+        const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        int socket = 0;
+        int core = cpu;
+        std::ifstream(dir + "physical_package_id") >> socket;
+        std::ifstream(dir + "core_id") >> core;
+        topology[socket][core].push_back(cpu);
+    }
+#endif
+    return topology;
+}
+
+// Logical CPUs for `thread_cnt` threads with the given placement; -1 leaves a thread unpinned. If there are
+// fewer suitable CPUs than threads the list wraps around and threads share CPUs. Returns std::nullopt if the
+// placement is impossible on this machine, i.e. cross-socket with a single socket.
+inline std::optional<std::vector<int>> pick_cpus(size_t thread_cnt, Placement placement) {
+    static const CpuTopology topology = read_cpu_topology();
+    if (topology.empty()) {
+        if (placement == Placement::CrossSocket) {
+            return std::nullopt;
+        }
+        return std::vector<int>(thread_cnt, -1);
+    }
+    std::vector<int> candidates;
+    switch (placement) {
+    case Placement::SameCore: {
+        // Prefer a core with SMT siblings.
+        const auto& cores = topology.begin()->second;
+        const auto* best = &cores.begin()->second;
+        for (const auto& [core, cpus] : cores) {
+            if (cpus.size() > best->size()) {
+                best = &cpus;
+            }
+        }
+        candidates = *best;
+        break;
+    }
+    case Placement::CrossCore:
+        for (const auto& [core, cpus] : topology.begin()->second) {
+            candidates.push_back(cpus.front());
+        }
+        break;
+    case Placement::CrossSocket: {
+        if (topology.size() < 2) {
+            return std::nullopt;
+        }
+        std::vector<std::vector<int>> per_socket;
+        for (const auto& [socket, cores] : topology) {
+            per_socket.emplace_back();
+            for (const auto& [core, cpus] : cores) {
+                per_socket.back().push_back(cpus.front());
+            }
+        }
+        for (size_t i = 0; candidates.size() < thread_cnt; ++i) {
+            const auto& cpus = per_socket[i % per_socket.size()];
+            candidates.push_back(cpus[i / per_socket.size() % cpus.size()]);
+        }
+        break;
+    }
+    }
+    std::vector<int> res(thread_cnt);
+    for (size_t i = 0; i < thread_cnt; ++i) {
+        res[i] = candidates[i % candidates.size()];
+    }
+    return res;
+}
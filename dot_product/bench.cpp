@@ -1,30 +1,354 @@
 #include "solution.h"
 #include "init.h"
+#include "mapped_file.h"
+#include "reduction.h"
+
+#include "perf_counters.h"
 
 #include <benchmark/benchmark.h>
 
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <CL/cl_version.h>
+#include <CL/opencl.hpp>
+
 namespace {
 
 constexpr size_t kVecSize = 100000;
+// Embedding-sized rows for the batched API.
+constexpr size_t kBatchDim = 256;
+
+std::unique_ptr<ISolution> float4_solution() {
+  return solution(4);
+}
+
+std::unique_ptr<ISolution> float8_solution() {
+  return solution(8);
+}
 
 void bench_ref(benchmark::State& state) {
+  PerfCounters perf;
   const auto [a, b] = init(kVecSize);
+  perf.start();
   for (auto _ : state) {
     benchmark::DoNotOptimize(reference_solution(a, b));
   }
+  perf.report(state);
+}
+
+// Copying both operands into the engine's existing device buffers.
+template <std::unique_ptr<ISolution> (*Factory)()>
+void bench_upload(benchmark::State& state) {
+  PerfCounters perf;
+  const auto [a, b] = init(kVecSize);
+  const auto sol = Factory();
+  sol->set_input(a, b);
+  perf.start();
+  for (auto _ : state) {
+    sol->set_a(a);
+    sol->set_b(b);
+  }
+  perf.report(state);
+  state.SetBytesProcessed(state.iterations() * 2 * kVecSize * sizeof(float));
 }
 
+// The kernel alone on resident operands.
+template <std::unique_ptr<ISolution> (*Factory)()>
+void bench_kernel(benchmark::State& state) {
+  PerfCounters perf;
+  const auto [a, b] = init(kVecSize);
+  const auto sol = Factory();
+  sol->set_input(a, b);
+  perf.start();
+  for (auto _ : state) {
+    sol->run_kernel();
+  }
+  perf.report(state);
+}
+
+// Reading back and summing the per-work-group partial results.
+template <std::unique_ptr<ISolution> (*Factory)()>
+void bench_readback(benchmark::State& state) {
+  PerfCounters perf;
+  const auto [a, b] = init(kVecSize);
+  const auto sol = Factory();
+  sol->set_input(a, b);
+  sol->run_kernel();
+  perf.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sol->get_output());
+  }
+  perf.report(state);
+}
+
+// A whole query with both operands new.
+template <std::unique_ptr<ISolution> (*Factory)()>
 void bench_sol(benchmark::State& state) {
+  PerfCounters perf;
   const auto [a, b] = init(kVecSize);
-  precompile();
+  const auto sol = Factory();
+  perf.start();
+  for (auto _ : state) {
+    sol->set_input(a, b);
+    sol->run_kernel();
+    benchmark::DoNotOptimize(sol->get_output());
+  }
+  perf.report(state);
+}
+
+// The host backend from L1-resident (4 KiB per operand) to DRAM-bound (128 MiB) vectors, on one thread and on
+// every hardware thread (thread count 0).
+void bench_cpu(benchmark::State& state) {
+  PerfCounters perf;
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto [a, b] = init(size);
+  const auto sol = cpu_solution(state.range(1));
+  sol->set_input(a, b);
+  perf.start();
+  for (auto _ : state) {
+    sol->run_kernel();
+    benchmark::DoNotOptimize(sol->get_output());
+  }
+  perf.report(state);
+  state.SetBytesProcessed(state.iterations() * 2 * size * sizeof(float));
+}
+
+// Two operand files in the temp directory that together take a quarter more than the device's global memory,
+// written on first use and removed at exit.
+class StreamFiles {
+public:
+  StreamFiles() :
+    a_path(std::filesystem::temp_directory_path() / "dot_product_stream_a.bin"),
+    b_path(std::filesystem::temp_directory_path() / "dot_product_stream_b.bin"),
+    size(cl::Device::getDefault().getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() * 5 / 8 / sizeof(float)) {
+    write_random(a_path, 1);
+    write_random(b_path, 2);
+  }
+  StreamFiles(const StreamFiles&) = delete;
+  StreamFiles& operator=(const StreamFiles&) = delete;
+  ~StreamFiles() {
+    std::filesystem::remove(a_path);
+    std::filesystem::remove(b_path);
+  }
+
+  const std::filesystem::path a_path;
+  const std::filesystem::path b_path;
+  const size_t size;
+private:
+  // In blocks, the whole file would not fit in memory either.
+  void write_random(const std::filesystem::path& path, unsigned seed) const {
+    std::default_random_engine re(seed);
+    std::uniform_real_distribution<float> dist(0.0, 1.0);
+    std::ofstream out(path, std::ios::binary);
+    std::vector<float> block(1 << 20);
+    for (size_t written = 0; written < size; written += block.size()) {
+      const size_t cnt = std::min(block.size(), size - written);
+      for (size_t i = 0; i < cnt; ++i) {
+        block[i] = dist(re);
+      }
+      out.write(reinterpret_cast<const char*>(block.data()), cnt * sizeof(float));
+    }
+    if (!out) {
+      throw std::runtime_error("can not write " + path.string());
+    }
+  }
+};
+
+// Streaming memory-mapped operands larger than device memory, by pipeline depth and chunk size. Once the
+// files are in the page cache this measures the host-to-device link, otherwise the disk.
+void bench_stream(benchmark::State& state) {
+  PerfCounters perf;
+  static const StreamFiles files;
+  const MappedFile a_file(files.a_path);
+  const MappedFile b_file(files.b_path);
+  const auto sol = streaming_solution(state.range(1), static_cast<int>(state.range(0)));
+  perf.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sol->run(a_file.floats(), b_file.floats()));
+  }
+  perf.report(state);
+  state.SetBytesProcessed(state.iterations() * 2 * files.size * sizeof(float));
+}
+
+// Scoring a query against range(0) candidate rows with one ISolution query per row, what the batched API
+// replaces.
+void bench_batch_loop(benchmark::State& state) {
+  PerfCounters perf;
+  const auto row_cnt = static_cast<size_t>(state.range(0));
+  const auto [query, candidates] = init(row_cnt * kBatchDim);
+  const std::vector<float> q(query.begin(), query.begin() + kBatchDim);
+  std::vector<std::vector<float>> rows;
+  for (size_t idx = 0; idx < row_cnt; ++idx) {
+    rows.emplace_back(candidates.begin() + idx * kBatchDim, candidates.begin() + (idx + 1) * kBatchDim);
+  }
+  const auto sol = solution();
+  perf.start();
+  for (auto _ : state) {
+    for (const auto& row : rows) {
+      sol->set_input(q, row);
+      sol->run_kernel();
+      benchmark::DoNotOptimize(sol->get_output());
+    }
+  }
+  perf.report(state);
+  state.SetItemsProcessed(state.iterations() * row_cnt);
+}
+
+// The same in one launch, reading back every score.
+void bench_batch_scores(benchmark::State& state) {
+  PerfCounters perf;
+  const auto row_cnt = static_cast<size_t>(state.range(0));
+  const auto [query, candidates] = init(row_cnt * kBatchDim);
+  const std::span<const float> q(query.data(), kBatchDim);
+  const auto sol = batch_solution();
+  perf.start();
   for (auto _ : state) {
-    benchmark::DoNotOptimize(solution(a, b));
+    benchmark::DoNotOptimize(sol->scores(q, candidates));
   }
+  perf.report(state);
+  state.SetItemsProcessed(state.iterations() * row_cnt);
+}
+
+// Reading back only the best range(1) rows.
+void bench_batch_top_k(benchmark::State& state) {
+  PerfCounters perf;
+  const auto row_cnt = static_cast<size_t>(state.range(0));
+  const auto [query, candidates] = init(row_cnt * kBatchDim);
+  const std::span<const float> q(query.data(), kBatchDim);
+  const auto sol = batch_solution();
+  perf.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sol->top_k(q, candidates, state.range(1)));
+  }
+  perf.report(state);
+  state.SetItemsProcessed(state.iterations() * row_cnt);
+}
+
+// Wall seconds per call of `run`, over calls for at least 100 ms.
+template <typename F>
+double seconds_per_call(const F& run) {
+  const auto start = std::chrono::steady_clock::now();
+  size_t calls = 0;
+  std::chrono::duration<double> elapsed{};
+  do {
+    run();
+    ++calls;
+    elapsed = std::chrono::steady_clock::now() - start;
+  } while (elapsed.count() < 0.1);
+  return elapsed.count() / calls;
+}
+
+// Formats for bench_format: fp32 (the ISolution engines) and then the encoded ones.
+constexpr Format kFormats[] = {Format::Fp16, Format::Bf16, Format::Int8};
+
+// The kernel on resident operands of range(1) elements in format range(0) (0 for fp32, then kFormats), on the
+// GPU or the CPU. bytes_per_second counts the stored bytes; speedup is against the fp32 engine on the same
+// operands, timed before the loop, in real time on both sides.
+template <bool Gpu>
+void bench_format(benchmark::State& state) {
+  PerfCounters perf;
+  const auto size = static_cast<size_t>(state.range(1));
+  const auto [a, b] = init(size);
+  const auto fp32 = Gpu ? solution(8) : cpu_solution();
+  fp32->set_input(a, b);
+  const double fp32_seconds = seconds_per_call([&]() {
+    fp32->run_kernel();
+  });
+  size_t bytes = sizeof(float);
+  std::unique_ptr<IEncodedSolution> sol;
+  if (state.range(0) != 0) {
+    const Format format = kFormats[state.range(0) - 1];
+    sol = Gpu ? encoded_solution(format) : encoded_cpu_solution(format);
+    sol->set_input(encode(a, format), encode(b, format));
+    bytes = element_bytes(format);
+    state.SetLabel(format_name(format));
+  } else {
+    state.SetLabel("fp32");
+  }
+  perf.start();
+  const auto start = std::chrono::steady_clock::now();
+  for (auto _ : state) {
+    if (sol) {
+      sol->run_kernel();
+    } else {
+      fp32->run_kernel();
+    }
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  perf.report(state);
+  state.SetBytesProcessed(state.iterations() * 2 * size * bytes);
+  state.counters["speedup"] = fp32_seconds * state.iterations() / elapsed.count();
+}
+
+// An operator of the reduction engine on range(0) elements, on the device or on the host threads. Only Dot
+// reads b. The bytes include the upload for the device.
+template <typename Engine, bool Binary>
+void bench_reduction(benchmark::State& state) {
+  PerfCounters perf;
+  const auto size = static_cast<size_t>(state.range(0));
+  const auto [a, b] = init(size);
+  Engine engine;
+  perf.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(engine.run(a, Binary ? std::span<const float>(b) : std::span<const float>()));
+  }
+  perf.report(state);
+  state.SetBytesProcessed(state.iterations() * (Binary ? 2 : 1) * size * sizeof(float));
 }
 
 }  // namespace
 
 BENCHMARK(bench_ref)->Unit(benchmark::kMicrosecond);
-BENCHMARK(bench_sol)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_cpu)
+  ->ArgsProduct({benchmark::CreateRange(1 << 10, 1 << 25, 8), {1, 0}})
+  ->ArgNames({"size", "threads"})
+  ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_stream)
+  ->ArgsProduct({{1, 2, 3}, {1 << 20, 1 << 22, 1 << 24}})
+  ->ArgNames({"depth", "chunk"})
+  ->UseRealTime()
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(bench_batch_loop)->Arg(1 << 10)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_batch_scores)->RangeMultiplier(8)->Range(1 << 10, 1 << 16)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_batch_top_k)
+  ->ArgsProduct({benchmark::CreateRange(1 << 10, 1 << 16, 8), {1, 10, 32}})
+  ->ArgNames({"rows", "k"})
+  ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_format<true>)
+  ->ArgsProduct({{0, 1, 2, 3}, {1 << 20, 1 << 24}})
+  ->ArgNames({"format", "size"})
+  ->UseRealTime()
+  ->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_format<false>)
+  ->ArgsProduct({{0, 1, 2, 3}, {1 << 14, 1 << 20, 1 << 24}})
+  ->ArgNames({"format", "size"})
+  ->UseRealTime()
+  ->Unit(benchmark::kMicrosecond);
+// Every reduction operator on the device and on the host.
+#define BENCH_REDUCTION(Op, Binary) \
+  BENCHMARK(bench_reduction<Reduction<Op>, Binary>)->Arg(1 << 20)->Arg(1 << 24)->Unit(benchmark::kMicrosecond); \
+  BENCHMARK(bench_reduction<HostReduction<Op>, Binary>)->Arg(1 << 20)->Arg(1 << 24)->Unit(benchmark::kMicrosecond)
+
+BENCH_REDUCTION(Dot, true);
+BENCH_REDUCTION(SquaredNorm, false);
+BENCH_REDUCTION(MaxAbs, false);
+BENCH_REDUCTION(ArgMin, false);
+BENCH_REDUCTION(Histogram16, false);
+
+BENCHMARK(bench_upload<basic_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_upload<float4_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_upload<float8_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_kernel<basic_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_kernel<float4_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_kernel<float8_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_readback<basic_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_readback<float4_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_readback<float8_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_sol<basic_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_sol<float4_solution>)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bench_sol<float8_solution>)->Unit(benchmark::kMicrosecond);
 
 BENCHMARK_MAIN();
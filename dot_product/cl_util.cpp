@@ -134,3 +134,24 @@ std::string get_error_string(int code) {
   }
   return std::to_string(code);
 }
+
+const char* const local_reduce_source = R"OpenCL(
+  void local_reduce(local value_t* local_res, value_t res) {
+    int lid = get_local_id(0);
+    local_res[lid] = res;
+    for (int stride = get_local_size(0) / 2; stride > 0; stride /= 2) {
+      barrier(CLK_LOCAL_MEM_FENCE);
+      if (lid < stride) {
+        local_res[lid] = op_combine(local_res[lid], local_res[lid + stride]);
+      }
+    }
+  }
+)OpenCL";
+
+size_t floor_pow2(size_t limit) {
+  size_t res = 1;
+  while (res * 2 <= limit) {
+    res *= 2;
+  }
+  return res;
+}
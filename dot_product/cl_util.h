@@ -1,4 +1,13 @@
+#include <cstddef>
 #include <string>
 
 void print_devices();
 std::string get_error_string(int code);
+
+// OpenCL C for the work-group stage of the two-level reductions: local_reduce(local_res, value) leaves the
+// op_combine of every work-item's value in local_res[0]. value_t and op_combine must be defined before it, and
+// the work-group size must be a power of two (see floor_pow2).
+extern const char* const local_reduce_source;
+
+// Largest power of two not above `limit`, the local reduction halves the work-group.
+size_t floor_pow2(size_t limit);
@@ -0,0 +1,371 @@
+#include "solution.h"
+#include "workers.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DOT_PRODUCT_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+// Accumulates in double: a running float sum drifts by more than the validation tolerance at 100k elements,
+// more than the pairwise sums of the engines do.
+float reference_solution(const std::vector<float>& a, const std::vector<float>& b) {
+  const auto sz = a.size();
+  double res = 0.0;
+  for (size_t i = 0; i < sz; ++i) {
+    res += static_cast<double>(a[i]) * b[i];
+  }
+  return static_cast<float>(res);
+}
+
+namespace {
+
+// Below this many elements the vectors are cache-resident and waking the workers costs more than it saves.
+constexpr size_t kMinParallelSize = 1 << 15;
+// Chunk boundaries are multiples of a cache line of floats.
+constexpr size_t kChunkAlign = 16;
+
+using DotKernel = float (*)(const float* a, const float* b, size_t n);
+
+// Eight independent accumulators, which compilers turn into vector code for whatever the baseline ISA is.
+float dot_portable(const float* a, const float* b, size_t n) {
+  float acc[8] = {};
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    for (size_t j = 0; j < 8; ++j) {
+      acc[j] += a[i + j] * b[i + j];
+    }
+  }
+  float res = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+  for (; i < n; ++i) {
+    res += a[i] * b[i];
+  }
+  return res;
+}
+
+#ifdef DOT_PRODUCT_X86_DISPATCH
+
+__attribute__((target("avx2,fma")))
+float dot_avx2(const float* a, const float* b, size_t n) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  __m256 acc2 = _mm256_setzero_ps();
+  __m256 acc3 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+    acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+  }
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+  }
+  const __m256 acc = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  float res = _mm_cvtss_f32(sum);
+  for (; i < n; ++i) {
+    res += a[i] * b[i];
+  }
+  return res;
+}
+
+__attribute__((target("avx512f")))
+float dot_avx512(const float* a, const float* b, size_t n) {
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+  __m512 acc2 = _mm512_setzero_ps();
+  __m512 acc3 = _mm512_setzero_ps();
+  size_t i = 0;
+  for (; i + 64 <= n; i += 64) {
+    acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), acc2);
+    acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), acc3);
+  }
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+  }
+  if (i < n) {
+    const __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+    acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc1);
+  }
+  return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+}
+
+#endif
+
+// The widest kernel the CPU we run on supports.
+DotKernel select_kernel() {
+#ifdef DOT_PRODUCT_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return dot_avx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return dot_avx2;
+  }
+#endif
+  return dot_portable;
+}
+
+struct alignas(64) PartialSum {
+  float val = 0.0f;
+};
+
+// Runs sum(begin, end) over [0, n) split into one cache-line aligned chunk per worker, or on the calling thread
+// for small inputs, and adds up the results.
+template <typename Sum>
+float split_sum(Workers& workers, std::vector<PartialSum>& partial, size_t n, const Sum& sum) {
+  if (n < kMinParallelSize || workers.size() == 1) {
+    return sum(0, n);
+  }
+  const size_t chunk = (n / workers.size() + kChunkAlign - 1) / kChunkAlign * kChunkAlign;
+  workers.run([&](size_t idx) {
+    const size_t begin = std::min(idx * chunk, n);
+    partial[idx].val = sum(begin, std::min(begin + chunk, n));
+  });
+  float res = 0.0f;
+  for (const auto& part : partial) {
+    res += part.val;
+  }
+  return res;
+}
+
+} // namespace
+
+class CpuSolution : public ISolution {
+public:
+  explicit CpuSolution(size_t thread_cnt) :
+    kernel(select_kernel()),
+    workers(default_thread_cnt(thread_cnt)),
+    partial(workers.size()) {
+  }
+  void set_input(const std::vector<float>& a, const std::vector<float>& b) override {
+    if (a.size() != b.size()) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    this->a.assign(a.begin(), a.end());
+    this->b.assign(b.begin(), b.end());
+  }
+  void set_a(const std::vector<float>& a) override {
+    check_size(a);
+    this->a.assign(a.begin(), a.end());
+  }
+  void set_b(const std::vector<float>& b) override {
+    check_size(b);
+    this->b.assign(b.begin(), b.end());
+  }
+  void run_kernel() override {
+    result = split_sum(workers, partial, a.size(), [&](size_t begin, size_t end) {
+      return kernel(a.data() + begin, b.data() + begin, end - begin);
+    });
+  }
+  float get_output() override {
+    return result;
+  }
+private:
+  void check_size(const std::vector<float>& operand) const {
+    if (operand.size() != a.size()) {
+      throw std::invalid_argument("operand size differs from the last set_input");
+    }
+  }
+
+  const DotKernel kernel;
+  Workers workers;
+  std::vector<PartialSum> partial;
+  std::vector<float> a;
+  std::vector<float> b;
+  float result = 0.0f;
+};
+
+std::unique_ptr<ISolution> cpu_solution(size_t thread_cnt) {
+  return std::make_unique<CpuSolution>(thread_cnt);
+}
+
+namespace {
+
+// Kernels over `n` encoded elements starting at a and b. Int8 ones return the unscaled integer sum.
+using EncodedKernel = float (*)(const uint8_t* a, const uint8_t* b, size_t n);
+
+uint16_t load_u16(const uint8_t* p, size_t idx) {
+  uint16_t bits;
+  std::memcpy(&bits, p + 2 * idx, sizeof(bits));
+  return bits;
+}
+
+template <float (*Widen)(uint16_t)>
+float dot_u16_portable(const uint8_t* a, const uint8_t* b, size_t n) {
+  float acc[8] = {};
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    for (size_t j = 0; j < 8; ++j) {
+      acc[j] += Widen(load_u16(a, i + j)) * Widen(load_u16(b, i + j));
+    }
+  }
+  float res = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+  for (; i < n; ++i) {
+    res += Widen(load_u16(a, i)) * Widen(load_u16(b, i));
+  }
+  return res;
+}
+
+float dot_int8_portable(const uint8_t* a, const uint8_t* b, size_t n) {
+  int64_t res = 0;
+  for (size_t i = 0; i < n; ++i) {
+    res += static_cast<int8_t>(a[i]) * static_cast<int8_t>(b[i]);
+  }
+  return static_cast<float>(res);
+}
+
+#ifdef DOT_PRODUCT_X86_DISPATCH
+
+__attribute__((target("avx2,fma,f16c")))
+float reduce_m256(__m256 acc) {
+  __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  sum = _mm_hadd_ps(sum, sum);
+  sum = _mm_hadd_ps(sum, sum);
+  return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float dot_fp16_avx2(const uint8_t* a, const uint8_t* b, size_t n) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    const auto* pa = reinterpret_cast<const __m128i*>(a + 2 * i);
+    const auto* pb = reinterpret_cast<const __m128i*>(b + 2 * i);
+    acc0 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128(pa)), _mm256_cvtph_ps(_mm_loadu_si128(pb)), acc0);
+    acc1 = _mm256_fmadd_ps(_mm256_cvtph_ps(_mm_loadu_si128(pa + 1)), _mm256_cvtph_ps(_mm_loadu_si128(pb + 1)), acc1);
+  }
+  float res = reduce_m256(_mm256_add_ps(acc0, acc1));
+  for (; i < n; ++i) {
+    res += half_to_float(load_u16(a, i)) * half_to_float(load_u16(b, i));
+  }
+  return res;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+__m256 widen_bf16(const uint8_t* p) {
+  const __m128i bits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(bits), 16));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float dot_bf16_avx2(const uint8_t* a, const uint8_t* b, size_t n) {
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm256_fmadd_ps(widen_bf16(a + 2 * i), widen_bf16(b + 2 * i), acc0);
+    acc1 = _mm256_fmadd_ps(widen_bf16(a + 2 * i + 16), widen_bf16(b + 2 * i + 16), acc1);
+  }
+  float res = reduce_m256(_mm256_add_ps(acc0, acc1));
+  for (; i < n; ++i) {
+    res += bf16_to_float(load_u16(a, i)) * bf16_to_float(load_u16(b, i));
+  }
+  return res;
+}
+
+// Sign-extends 16 int8 to int16 and multiplies pairwise into eight int32 sums of two products. Those grow by at
+// most 2 * 127 * 127 per step, so the int32 lanes are moved into int64 every kInt8Block steps.
+__attribute__((target("avx2,fma,f16c")))
+float dot_int8_avx2(const uint8_t* a, const uint8_t* b, size_t n) {
+  constexpr size_t kInt8Block = 1 << 15;
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  while (i + 16 <= n) {
+    __m256i acc = _mm256_setzero_si256();
+    for (size_t step = 0; step < kInt8Block && i + 16 <= n; ++step, i += 16) {
+      const __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+      const __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+      acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(acc)));
+    total = _mm256_add_epi64(total, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(acc, 1)));
+  }
+  alignas(32) int64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), total);
+  int64_t res = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  for (; i < n; ++i) {
+    res += static_cast<int8_t>(a[i]) * static_cast<int8_t>(b[i]);
+  }
+  return static_cast<float>(res);
+}
+
+#endif
+
+EncodedKernel select_encoded_kernel(Format format) {
+#ifdef DOT_PRODUCT_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+    switch (format) {
+    case Format::Fp16: return dot_fp16_avx2;
+    case Format::Bf16: return dot_bf16_avx2;
+    case Format::Int8: return dot_int8_avx2;
+    }
+  }
+#endif
+  switch (format) {
+  case Format::Fp16: return dot_u16_portable<half_to_float>;
+  case Format::Bf16: return dot_u16_portable<bf16_to_float>;
+  case Format::Int8: return dot_int8_portable;
+  }
+  return nullptr;
+}
+
+} // namespace
+
+class EncodedCpuSolution : public IEncodedSolution {
+public:
+  EncodedCpuSolution(Format format, size_t thread_cnt) :
+    format(format),
+    kernel(select_encoded_kernel(format)),
+    workers(default_thread_cnt(thread_cnt)),
+    partial(workers.size()) {
+  }
+  void set_input(const EncodedVector& a, const EncodedVector& b) override {
+    if (a.format != format || b.format != format) {
+      throw std::invalid_argument("operand format differs from the engine's");
+    }
+    if (a.size != b.size) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    this->a = a.data;
+    this->b = b.data;
+    size = a.size;
+    scale = a.scale * b.scale;
+  }
+  void run_kernel() override {
+    const size_t bytes = element_bytes(format);
+    result = split_sum(workers, partial, size, [&](size_t begin, size_t end) {
+      return kernel(a.data() + begin * bytes, b.data() + begin * bytes, end - begin);
+    });
+  }
+  float get_output() override {
+    return result * scale;
+  }
+private:
+  const Format format;
+  const EncodedKernel kernel;
+  Workers workers;
+  std::vector<PartialSum> partial;
+  std::vector<uint8_t> a;
+  std::vector<uint8_t> b;
+  size_t size = 0;
+  float scale = 1.0f;
+  float result = 0.0f;
+};
+
+std::unique_ptr<IEncodedSolution> encoded_cpu_solution(Format format, size_t thread_cnt) {
+  return std::make_unique<EncodedCpuSolution>(format, thread_cnt);
+}
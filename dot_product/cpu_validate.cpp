@@ -0,0 +1,19 @@
+#include "validate.h"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+// Validates the host backend alone, so it can be checked on machines without an OpenCL platform or SDK.
+int main() {
+  try {
+    if (!validate_cpu()) {
+      return EXIT_FAILURE;
+    }
+    std::cout << "Validation Successful" << std::endl;
+    return EXIT_SUCCESS;
+  } catch (const std::exception& err) {
+    std::cerr << "C++ exception: " << err.what() << std::endl;
+  }
+  return EXIT_FAILURE;
+}
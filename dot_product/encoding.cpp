@@ -0,0 +1,143 @@
+#include "encoding.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+const char* format_name(Format format) {
+  switch (format) {
+  case Format::Fp16: return "fp16";
+  case Format::Bf16: return "bf16";
+  case Format::Int8: return "int8";
+  }
+  return "";
+}
+
+size_t element_bytes(Format format) {
+  return format == Format::Int8 ? 1 : 2;
+}
+
+double unit_roundoff(Format format) {
+  switch (format) {
+  case Format::Fp16: return std::ldexp(1.0, -11);
+  case Format::Bf16: return std::ldexp(1.0, -8);
+  case Format::Int8: return 0.5 / 127.0;
+  }
+  return 0.0;
+}
+
+uint16_t float_to_half(float value) {
+  const uint32_t bits = std::bit_cast<uint32_t>(value);
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const uint32_t abs = bits & 0x7fffffff;
+  if (abs >= 0x7f800000) {
+    // Infinity, or a NaN that keeps the top of its payload and is quieted, as vcvtps2ph does.
+    return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 | ((abs >> 13) & 0x3ff) : 0);
+  }
+  if (abs >= 0x477ff000) {
+    // Rounds to at least 65536.
+    return sign | 0x7c00;
+  }
+  if (abs < 0x38800000) {
+    // Subnormal or zero as a half: align the mantissa with the implicit bit to 2^-24 units, then round.
+    if (abs < 0x33000000) {
+      return sign;
+    }
+    const uint32_t exp = abs >> 23;
+    const uint32_t mant = (abs & 0x7fffff) | 0x800000;
+    const uint32_t shift = 126 - exp;
+    const uint32_t half_ulp = 1u << (shift - 1);
+    const uint32_t rest = mant & ((1u << shift) - 1);
+    uint32_t res = mant >> shift;
+    if (rest > half_ulp || (rest == half_ulp && (res & 1))) {
+      ++res;
+    }
+    return sign | static_cast<uint16_t>(res);
+  }
+  // Normal: rebias the exponent and round the 13 dropped mantissa bits; a carry moves into the exponent.
+  const uint32_t rebiased = abs - (112u << 23);
+  const uint32_t rest = rebiased & 0x1fff;
+  uint32_t res = rebiased >> 13;
+  if (rest > 0x1000 || (rest == 0x1000 && (res & 1))) {
+    ++res;
+  }
+  return sign | static_cast<uint16_t>(res);
+}
+
+float half_to_float(uint16_t bits) {
+  const uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+  const uint32_t exp = (bits >> 10) & 0x1f;
+  const uint32_t mant = bits & 0x3ff;
+  if (exp == 0x1f) {
+    // Infinity, or a NaN with its payload carried over and the quiet bit set.
+    return std::bit_cast<float>(sign | 0x7f800000 | (mant != 0 ? 0x400000 : 0) | (mant << 13));
+  }
+  if (exp == 0) {
+    // Zero or subnormal, exact in float.
+    const float abs = std::ldexp(static_cast<float>(mant), -24);
+    return sign != 0 ? -abs : abs;
+  }
+  return std::bit_cast<float>(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+uint16_t float_to_bf16(float value) {
+  const uint32_t bits = std::bit_cast<uint32_t>(value);
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    return static_cast<uint16_t>((bits >> 16) | 0x40);
+  }
+  // Adding 0x7fff plus the lowest kept bit rounds to nearest even; overflow correctly carries to infinity.
+  return static_cast<uint16_t>((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+}
+
+float bf16_to_float(uint16_t bits) {
+  return std::bit_cast<float>(static_cast<uint32_t>(bits) << 16);
+}
+
+EncodedVector encode(std::span<const float> values, Format format) {
+  EncodedVector res;
+  res.format = format;
+  res.size = values.size();
+  res.data.resize(values.size() * element_bytes(format));
+  switch (format) {
+  case Format::Fp16:
+  case Format::Bf16:
+    for (size_t i = 0; i < values.size(); ++i) {
+      const uint16_t bits = format == Format::Fp16 ? float_to_half(values[i]) : float_to_bf16(values[i]);
+      std::memcpy(res.data.data() + 2 * i, &bits, sizeof(bits));
+    }
+    break;
+  case Format::Int8: {
+    float max_abs = 0.0f;
+    for (const float value : values) {
+      max_abs = std::max(max_abs, std::fabs(value));
+    }
+    res.scale = max_abs > 0.0f ? max_abs / 127.0f : 1.0f;
+    for (size_t i = 0; i < values.size(); ++i) {
+      const float q = std::clamp(std::nearbyint(values[i] / res.scale), -127.0f, 127.0f);
+      res.data[i] = static_cast<uint8_t>(static_cast<int8_t>(q));
+    }
+    break;
+  }
+  }
+  return res;
+}
+
+std::vector<float> decode(const EncodedVector& vec) {
+  std::vector<float> res(vec.size);
+  for (size_t i = 0; i < vec.size; ++i) {
+    switch (vec.format) {
+    case Format::Fp16:
+    case Format::Bf16: {
+      uint16_t bits;
+      std::memcpy(&bits, vec.data.data() + 2 * i, sizeof(bits));
+      res[i] = vec.format == Format::Fp16 ? half_to_float(bits) : bf16_to_float(bits);
+      break;
+    }
+    case Format::Int8:
+      res[i] = vec.scale * static_cast<int8_t>(vec.data[i]);
+      break;
+    }
+  }
+  return res;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Narrower storage formats for dot product operands. They only change what is read from memory, products are
+// accumulated in fp32 (int32 for int8).
+enum class Format {
+  Fp16, // IEEE half precision
+  Bf16, // the upper half of an fp32
+  Int8, // symmetric linear quantization: value = scale * q, q in [-127, 127]
+};
+
+const char* format_name(Format format);
+size_t element_bytes(Format format);
+// Largest relative error encode() makes on one element: half an ulp, for int8 half a step relative to the
+// largest magnitude of the vector.
+double unit_roundoff(Format format);
+
+// Round to nearest even; values out of range become infinities. NaNs keep the top of their payload and come
+// out quiet, so both directions match the F16C instructions for every input.
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t bits);
+uint16_t float_to_bf16(float value);
+float bf16_to_float(uint16_t bits);
+
+// A vector in one of the formats: `size` elements of element_bytes(format) bytes each in `data`, and the scale
+// of an int8 vector (1 for the others).
+struct EncodedVector {
+  Format format = Format::Fp16;
+  size_t size = 0;
+  float scale = 1.0f;
+  std::vector<uint8_t> data;
+};
+
+EncodedVector encode(std::span<const float> values, Format format);
+std::vector<float> decode(const EncodedVector& vec);
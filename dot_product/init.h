@@ -1,3 +1,5 @@
+#include <cstddef>
+#include <utility>
 #include <vector>
 
 std::pair<std::vector<float>, std::vector<float>> init(size_t size);
@@ -0,0 +1,115 @@
+#include "mapped_file.h"
+
+#include <string>
+#include <system_error>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+namespace {
+
+[[noreturn]] void throw_last_error(const char* what, const std::filesystem::path& path) {
+  throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), what + (": " + path.string()));
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  file = CreateFileW(
+    path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr
+  );
+  if (file == INVALID_HANDLE_VALUE) {
+    file = nullptr;
+    throw_last_error("CreateFile", path);
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size)) {
+    CloseHandle(file);
+    throw_last_error("GetFileSizeEx", path);
+  }
+  bytes = static_cast<size_t>(size.QuadPart);
+  // Empty files can not be mapped and need no mapping.
+  if (bytes == 0) {
+    return;
+  }
+  mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    throw_last_error("CreateFileMapping", path);
+  }
+  data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw_last_error("MapViewOfFile", path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) {
+    UnmapViewOfFile(data);
+  }
+  if (mapping != nullptr) {
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+}
+
+#else
+
+namespace {
+
+[[noreturn]] void throw_errno(const char* what, const std::filesystem::path& path) {
+  throw std::system_error(errno, std::generic_category(), what + (": " + path.string()));
+}
+
+} // namespace
+
+MappedFile::MappedFile(const std::filesystem::path& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw_errno("open", path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int err = errno;
+    close(fd);
+    errno = err;
+    throw_errno("fstat", path);
+  }
+  bytes = static_cast<size_t>(st.st_size);
+  // Empty files can not be mapped and need no mapping.
+  if (bytes == 0) {
+    close(fd);
+    return;
+  }
+  void* addr = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file referenced.
+  const int err = errno;
+  close(fd);
+  if (addr == MAP_FAILED) {
+    errno = err;
+    throw_errno("mmap", path);
+  }
+  madvise(addr, bytes, MADV_SEQUENTIAL);
+  data = addr;
+}
+
+MappedFile::~MappedFile() {
+  if (data != nullptr) {
+    munmap(const_cast<void*>(data), bytes);
+  }
+}
+
+#endif
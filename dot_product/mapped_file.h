@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Read-only memory map of a whole file of raw floats, for feeding the streaming engine without reading the
+// file into memory first. The mapping is hinted for sequential access. Throws std::system_error if the file
+// can not be opened or mapped.
+class MappedFile {
+public:
+  explicit MappedFile(const std::filesystem::path& path);
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  std::span<const float> floats() const {
+    return {static_cast<const float*>(data), bytes / sizeof(float)};
+  }
+private:
+  const void* data = nullptr;
+  size_t bytes = 0;
+#ifdef _WIN32
+  void* file = nullptr;
+  void* mapping = nullptr;
+#endif
+};
@@ -0,0 +1,149 @@
+#include "reduction.h"
+#include "cl_util.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <CL/cl_version.h>
+#include <CL/opencl.hpp>
+
+namespace {
+
+// Follows the operator's helpers (value_t, op_identity, op_map, op_combine) and local_reduce_source.
+const char* reduction_kernels = R"OpenCL(
+  // Stage 1: every work-item folds a strided share into two independent accumulators, the work-group reduces
+  // once and writes its partial value.
+  void kernel reduce_partial(
+    global const float* a,
+    global const float* b,
+    int N,
+    local value_t* local_res,
+    global value_t* partial
+  ) {
+    int sz = get_global_size(0);
+    int idx = get_global_id(0);
+    value_t acc0 = op_identity();
+    value_t acc1 = op_identity();
+    for (; idx + sz < N; idx += 2 * sz) {
+      acc0 = op_combine(acc0, op_map(a[idx], b[idx], idx));
+      acc1 = op_combine(acc1, op_map(a[idx + sz], b[idx + sz], idx + sz));
+    }
+    if (idx < N) {
+      acc0 = op_combine(acc0, op_map(a[idx], b[idx], idx));
+    }
+    local_reduce(local_res, op_combine(acc0, acc1));
+    if (get_local_id(0) == 0) {
+      partial[get_group_id(0)] = local_res[0];
+    }
+  }
+
+  // Stage 2: a single work-group reduces the partials.
+  void kernel reduce_final(global const value_t* partial, int count, local value_t* local_res, global value_t* res) {
+    value_t acc = op_identity();
+    for (int idx = get_local_id(0); idx < count; idx += get_local_size(0)) {
+      acc = op_combine(acc, partial[idx]);
+    }
+    local_reduce(local_res, acc);
+    if (get_local_id(0) == 0) {
+      res[0] = local_res[0];
+    }
+  }
+)OpenCL";
+
+std::string generate_source(const ReductionSource& op) {
+  return std::string("// ") + op.name + "\n" + op.prelude + "\n" +
+    "typedef " + op.type + " value_t;\n"
+    "value_t op_identity() {\n  return " + op.identity + ";\n}\n"
+    "value_t op_map(float a, float b, uint i) {\n  return " + op.map + ";\n}\n"
+    "value_t op_combine(value_t x, value_t y) {\n  return " + op.combine + ";\n}\n" +
+    local_reduce_source + reduction_kernels;
+}
+
+// Built programs by generated source. Engines create their own kernel objects from them, so only the map is
+// shared between threads.
+cl::Program cached_program(const ReductionSource& op) {
+  static std::mutex mutex;
+  static std::map<std::string, cl::Program> programs;
+  const std::string source = generate_source(op);
+  std::lock_guard lock(mutex);
+  auto it = programs.find(source);
+  if (it == programs.end()) {
+    cl::Program program(source);
+    program.build();
+    it = programs.emplace(source, program).first;
+  }
+  return it->second;
+}
+
+} // namespace
+
+class ReductionKernel : public IReductionKernel {
+public:
+  ReductionKernel(const ReductionSource& op, size_t value_bytes) :
+    program(cached_program(op)),
+    reduce_partial(program, "reduce_partial"),
+    reduce_final(program, "reduce_final"),
+    value_bytes(value_bytes),
+    work_group_size(floor_pow2(std::min(256uz, cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()))),
+    compute_units(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()),
+    result_buffer(CL_MEM_WRITE_ONLY, value_bytes) {
+    resize(0);
+  }
+  void run(std::span<const float> a, std::span<const float> b, void* res) override {
+    const bool unary = b.empty();
+    if (!unary && a.size() != b.size()) {
+      throw std::invalid_argument("reduction operands differ in size");
+    }
+    if (a.size() != N) {
+      resize(a.size());
+    }
+    if (!a.empty()) {
+      enqueueWriteBuffer(a_buffer, CL_TRUE, 0, a.size_bytes(), a.data());
+    }
+    if (!unary && !b.empty()) {
+      enqueueWriteBuffer(b_buffer, CL_TRUE, 0, b.size_bytes(), b.data());
+    }
+    const auto local_res = cl::Local(work_group_size * value_bytes);
+    // The queue is in order, the second stage starts when the first is done.
+    reduce_partial(
+      cl::EnqueueArgs(cl::NDRange(work_group_count * work_group_size), cl::NDRange(work_group_size)),
+      a_buffer, unary ? a_buffer : b_buffer, static_cast<int>(N), local_res, partial_buffer
+    );
+    reduce_final(
+      cl::EnqueueArgs(cl::NDRange(work_group_size), cl::NDRange(work_group_size)),
+      partial_buffer, static_cast<int>(work_group_count), local_res, result_buffer
+    );
+    enqueueReadBuffer(result_buffer, CL_TRUE, 0, value_bytes, res);
+  }
+private:
+  // An empty input still gets one-element buffers, the kernels then only write identities.
+  void resize(size_t size) {
+    N = size;
+    const size_t bytes = std::max(N, 1uz) * sizeof(float);
+    work_group_count = std::max(1uz, std::min(
+      (N + 2 * work_group_size - 1) / (2 * work_group_size),
+      4uz * compute_units
+    ));
+    a_buffer = cl::Buffer(CL_MEM_READ_ONLY, bytes);
+    b_buffer = cl::Buffer(CL_MEM_READ_ONLY, bytes);
+    partial_buffer = cl::Buffer(CL_MEM_READ_WRITE, work_group_count * value_bytes);
+  }
+
+  cl::Program program;
+  cl::KernelFunctor<cl::Buffer, cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> reduce_partial;
+  cl::KernelFunctor<cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> reduce_final;
+  const size_t value_bytes;
+  const size_t work_group_size;
+  const size_t compute_units;
+  size_t N = 0;
+  size_t work_group_count = 0;
+  cl::Buffer a_buffer;
+  cl::Buffer b_buffer;
+  cl::Buffer partial_buffer;
+  cl::Buffer result_buffer;
+};
+
+std::unique_ptr<IReductionKernel> reduction_kernel(const ReductionSource& op, size_t value_bytes) {
+  return std::make_unique<ReductionKernel>(op, value_bytes);
+}
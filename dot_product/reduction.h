@@ -0,0 +1,250 @@
+#pragma once
+
+#include "workers.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+// Reductions of one or two float vectors, generated from operator descriptors. A descriptor has the OpenCL C
+// side as strings and the same operator as host functions:
+// - kName: for the generated source and build errors.
+// - kPrelude: OpenCL C types and helpers the expressions use, may be empty.
+// - kType: the OpenCL type of the accumulator, laid out like the host type Value.
+// - kIdentity: the neutral element.
+// - kMap: the value of one element, from `a`, `b` (a again for one vector) and the element index `i`.
+// - kCombine: merges the values `x` and `y`. It must be associative and commutative, the device folds in
+//   whatever order its work-items run.
+
+// Sum of a[i] * b[i], the dot product as a reduction.
+struct Dot {
+  using Value = float;
+  static constexpr const char* kName = "dot";
+  static constexpr const char* kPrelude = "";
+  static constexpr const char* kType = "float";
+  static constexpr const char* kIdentity = "0.0f";
+  static constexpr const char* kMap = "a * b";
+  static constexpr const char* kCombine = "x + y";
+
+  static Value identity() {
+    return 0.0f;
+  }
+  static Value map(float a, float b, size_t) {
+    return a * b;
+  }
+  static Value combine(Value x, Value y) {
+    return x + y;
+  }
+};
+
+// Sum of squares, the square of the L2 norm.
+struct SquaredNorm {
+  using Value = float;
+  static constexpr const char* kName = "squared_norm";
+  static constexpr const char* kPrelude = "";
+  static constexpr const char* kType = "float";
+  static constexpr const char* kIdentity = "0.0f";
+  static constexpr const char* kMap = "a * a";
+  static constexpr const char* kCombine = "x + y";
+
+  static Value identity() {
+    return 0.0f;
+  }
+  static Value map(float a, float, size_t) {
+    return a * a;
+  }
+  static Value combine(Value x, Value y) {
+    return x + y;
+  }
+};
+
+// Largest magnitude, the infinity norm.
+struct MaxAbs {
+  using Value = float;
+  static constexpr const char* kName = "max_abs";
+  static constexpr const char* kPrelude = "";
+  static constexpr const char* kType = "float";
+  static constexpr const char* kIdentity = "0.0f";
+  static constexpr const char* kMap = "fabs(a)";
+  static constexpr const char* kCombine = "fmax(x, y)";
+
+  static Value identity() {
+    return 0.0f;
+  }
+  static Value map(float a, float, size_t) {
+    return std::fabs(a);
+  }
+  static Value combine(Value x, Value y) {
+    return std::fmax(x, y);
+  }
+};
+
+// Smallest element and its index, the lowest index among equal ones. NaNs are never the minimum.
+struct ArgMin {
+  struct Value {
+    float value;
+    uint32_t index;
+  };
+  static constexpr const char* kName = "arg_min";
+  static constexpr const char* kPrelude = R"OpenCL(
+    typedef struct {
+      float value;
+      uint index;
+    } arg_min_t;
+
+    arg_min_t arg_min(float value, uint index) {
+      arg_min_t res;
+      res.value = value;
+      res.index = index;
+      return res;
+    }
+  )OpenCL";
+  static constexpr const char* kType = "arg_min_t";
+  static constexpr const char* kIdentity = "arg_min(INFINITY, UINT_MAX)";
+  static constexpr const char* kMap = "arg_min(a, i)";
+  static constexpr const char* kCombine = "y.value < x.value || (y.value == x.value && y.index < x.index) ? y : x";
+
+  static Value identity() {
+    return {std::numeric_limits<float>::infinity(), std::numeric_limits<uint32_t>::max()};
+  }
+  static Value map(float a, float, size_t i) {
+    return {a, static_cast<uint32_t>(i)};
+  }
+  static Value combine(Value x, Value y) {
+    return y.value < x.value || (y.value == x.value && y.index < x.index) ? y : x;
+  }
+};
+
+// Counts of the elements in 16 equal bins over [0, 1), values outside go to the first or last bin. The
+// accumulator is a uint16 vector, so the bins reduce like any other value.
+struct Histogram16 {
+  using Value = std::array<uint32_t, 16>;
+  static constexpr const char* kName = "histogram16";
+  static constexpr const char* kPrelude = R"OpenCL(
+    uint16 one_hot(float a) {
+      int bin = clamp(convert_int_sat(a * 16.0f), 0, 15);
+      int16 bins = (int16)(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+      return as_uint16((int16)(bin) == bins) & (uint16)(1);
+    }
+  )OpenCL";
+  static constexpr const char* kType = "uint16";
+  static constexpr const char* kIdentity = "(uint16)(0)";
+  static constexpr const char* kMap = "one_hot(a)";
+  static constexpr const char* kCombine = "x + y";
+
+  static Value identity() {
+    return {};
+  }
+  static Value map(float a, float, size_t) {
+    Value res{};
+    res[bin(a)] = 1;
+    return res;
+  }
+  static Value combine(const Value& x, const Value& y) {
+    Value res;
+    for (size_t i = 0; i < res.size(); ++i) {
+      res[i] = x[i] + y[i];
+    }
+    return res;
+  }
+  // The saturating conversion of the kernel, which turns NaNs into 0.
+  static size_t bin(float a) {
+    const float scaled = a * 16.0f;
+    return !(scaled >= 1.0f) ? 0 : scaled >= 15.0f ? 15 : static_cast<size_t>(scaled);
+  }
+};
+
+// The OpenCL side of a descriptor.
+struct ReductionSource {
+  const char* name;
+  const char* prelude;
+  const char* type;
+  const char* identity;
+  const char* map;
+  const char* combine;
+};
+
+// Device half of Reduction<Op>, independent of the host type. run() writes `value_bytes` bytes of the result
+// to `res`; `b` may be empty for operators of one vector.
+class IReductionKernel {
+public:
+  virtual ~IReductionKernel() {};
+  virtual void run(std::span<const float> a, std::span<const float> b, void* res) = 0;
+};
+
+// The program for an operator is built once per process and shared by every engine of that operator.
+std::unique_ptr<IReductionKernel> reduction_kernel(const ReductionSource& op, size_t value_bytes);
+
+// On-device reduction with the two-level strategy of solution(): work-items fold strided shares with two
+// accumulators, work-groups reduce in local memory, one work-group reduces the partials, and only the result is
+// read back. Buffers are kept while the size stays the same.
+template <typename Op>
+class Reduction {
+public:
+  Reduction() :
+    kernel(reduction_kernel(
+      {Op::kName, Op::kPrelude, Op::kType, Op::kIdentity, Op::kMap, Op::kCombine}, sizeof(typename Op::Value)
+    )) {
+  }
+  typename Op::Value run(std::span<const float> a, std::span<const float> b = {}) {
+    typename Op::Value res;
+    kernel->run(a, b, &res);
+    return res;
+  }
+private:
+  std::unique_ptr<IReductionKernel> kernel;
+};
+
+// The same operator on the host, for validation: one contiguous chunk per worker thread.
+template <typename Op>
+class HostReduction {
+public:
+  explicit HostReduction(size_t thread_cnt = 0) : workers(default_thread_cnt(thread_cnt)), partial(workers.size()) {
+  }
+  typename Op::Value run(std::span<const float> a, std::span<const float> b = {}) {
+    if (b.empty()) {
+      b = a;
+    }
+    if (a.size() != b.size()) {
+      throw std::invalid_argument("reduction operands differ in size");
+    }
+    const size_t n = a.size();
+    const size_t chunk = (n + workers.size() - 1) / workers.size();
+    workers.run([&](size_t idx) {
+      const size_t begin = std::min(idx * chunk, n);
+      const size_t end = std::min(begin + chunk, n);
+      // Folding blocks separately keeps float sums from drifting, the rounding error then grows with the block
+      // length and the block count instead of the chunk length.
+      auto acc = Op::identity();
+      for (size_t block = begin; block < end; block += kBlockSize) {
+        auto block_acc = Op::identity();
+        for (size_t i = block; i < std::min(block + kBlockSize, end); ++i) {
+          block_acc = Op::combine(block_acc, Op::map(a[i], b[i], i));
+        }
+        acc = Op::combine(acc, block_acc);
+      }
+      partial[idx].value = acc;
+    });
+    auto res = Op::identity();
+    for (const auto& part : partial) {
+      res = Op::combine(res, part.value);
+    }
+    return res;
+  }
+private:
+  static constexpr size_t kBlockSize = 1024;
+
+  struct alignas(64) Partial {
+    typename Op::Value value;
+  };
+
+  Workers workers;
+  std::vector<Partial> partial;
+};
@@ -1,58 +1,21 @@
 #include "solution.h"
+#include "cl_util.h"
 
-#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <numeric>
-#include <iostream>
+#include <stdexcept>
+#include <string>
 
 #include <CL/cl_version.h>
 #include <CL/opencl.hpp>
 
-float reference_solution(const std::vector<float>& a, const std::vector<float>& b) {
-  const auto sz = a.size();
-  float res = 0.0;
-  for (int i = 0; i < sz; ++i) {
-    res += a[i] * b[i];
-  }
-  return res;
-}
-
 namespace {
 
-template <typename T>
-class BufferMapping {
-public:
-  BufferMapping(const cl::Buffer& buffer, cl_map_flags flags) : buffer(buffer) {
-    const auto buffer_size = buffer.getInfo<CL_MEM_SIZE>();
-    cl::Event event;
-    buffer_ptr = static_cast<T*>(enqueueMapBuffer(buffer, CL_FALSE, flags, 0, buffer_size, nullptr, &event));
-    event.wait();
-  }
-
-  ~BufferMapping() {
-    try {
-      unmap();
-    } catch (...) {
-    }
-  }
- 
-  T* ptr() {
-    return buffer_ptr;
-  }
-
-  void unmap() {
-    if (buffer_ptr == nullptr) {
-      return;
-    }
-    cl::Event event;
-    enqueueUnmapMemObject(buffer, buffer_ptr, nullptr, &event);
-    event.wait();
-    buffer_ptr = nullptr;
-  }
-
-private:
-  const cl::Buffer& buffer;
-  T* buffer_ptr;
-};
+// The operand size of an engine before its first set_input, distinct from the size of empty operands: an
+// empty set_input still has to move the engine to N == 0, whose dot product is 0 without any launch.
+constexpr size_t kNotSized = std::numeric_limits<size_t>::max();
 
 const char* dot_product_kernel = R"OpenCL(
   void kernel dot_product(global float* a, global float* b, local float* local_res, int N, global float* final_res) {
@@ -79,54 +42,833 @@ const char* dot_product_kernel = R"OpenCL(
   }
 )OpenCL";
 
-cl::Program program;
+} // namespace
+
+class Basic : public ISolution {
+public:
+  Basic() :
+    program(dot_product_kernel, true),
+    dot_product(program, "dot_product"),
+    max_work_group_size(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()),
+    compute_units(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()) {
+  }
+  void set_input(const std::vector<float>& a, const std::vector<float>& b) override {
+    if (a.size() != b.size()) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    if (a.size() != N) {
+      resize(a.size());
+    }
+    write(a_buffer, a);
+    write(b_buffer, b);
+  }
+  void set_a(const std::vector<float>& a) override {
+    check_size(a);
+    write(a_buffer, a);
+  }
+  void set_b(const std::vector<float>& b) override {
+    check_size(b);
+    write(b_buffer, b);
+  }
+  void run_kernel() override {
+    if (N == 0) {
+      return;
+    }
+    dot_product(
+      cl::EnqueueArgs(
+        cl::NDRange(work_group_count * work_group_size),
+        cl::NDRange(work_group_size)
+      ),
+      a_buffer, b_buffer, cl::Local(work_group_size * sizeof(float)), static_cast<int>(N), final_res_buffer
+    ).wait();
+  }
+  float get_output() override {
+    if (N == 0) {
+      return 0.0f;
+    }
+    enqueueReadBuffer(final_res_buffer, CL_TRUE, 0, final_res.size() * sizeof(float), final_res.data());
+    return std::accumulate(final_res.begin(), final_res.end(), 0.0f);
+  }
+private:
+  // Buffers and launch configuration only change with the vector size.
+  void resize(size_t size) {
+    N = size;
+    if (N == 0) {
+      return;
+    }
+    work_group_size = std::min({N, 256uz, max_work_group_size});
+    work_group_count = std::min((N + work_group_size - 1) / work_group_size, 4uz * compute_units);
+    a_buffer = cl::Buffer(CL_MEM_READ_ONLY, N * sizeof(float));
+    b_buffer = cl::Buffer(CL_MEM_READ_ONLY, N * sizeof(float));
+    final_res_buffer = cl::Buffer(CL_MEM_WRITE_ONLY, work_group_count * sizeof(float));
+    final_res.resize(work_group_count);
+  }
+  void check_size(const std::vector<float>& operand) const {
+    if (operand.size() != N) {
+      throw std::invalid_argument("operand size differs from the last set_input");
+    }
+  }
+  static void write(const cl::Buffer& buffer, const std::vector<float>& data) {
+    if (!data.empty()) {
+      enqueueWriteBuffer(buffer, CL_TRUE, 0, data.size() * sizeof(float), data.data());
+    }
+  }
+
+  cl::Program program;
+  cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::LocalSpaceArg, int, cl::Buffer> dot_product;
+  const size_t max_work_group_size;
+  const size_t compute_units;
+  size_t N = kNotSized;
+  size_t work_group_size = 0;
+  size_t work_group_count = 0;
+  cl::Buffer a_buffer;
+  cl::Buffer b_buffer;
+  cl::Buffer final_res_buffer;
+  std::vector<float> final_res;
+};
+
+std::unique_ptr<ISolution> basic_solution() {
+  return std::make_unique<Basic>();
+}
+
+namespace {
+
+// The kernels below sum floats with local_reduce from cl_util.h.
+std::string float_sum_source(const std::string& kernels) {
+  return std::string("typedef float value_t;\nvalue_t op_combine(value_t x, value_t y) {\n  return x + y;\n}\n") +
+    local_reduce_source + kernels;
+}
+
+// WIDTH (4 or 8) is passed as a build option. The buffers are zero-padded to a multiple of WIDTH floats, so
+// the kernel only sees whole vectors. With ACCUMULATE defined the partial sums are added to, not overwritten,
+// so that launches on one in-order queue can reduce consecutive chunks into the same partials.
+const char* dot_product_vectorized_kernel = R"OpenCL(
+  #define CAT(a, b) a##b
+  #define VEC(a, b) CAT(a, b)
+  #define floatN VEC(float, WIDTH)
+
+  // Stage 1: every work-item accumulates a strided share of the vectors in four independent accumulators, the
+  // work-group reduces once and writes its partial sum.
+  void kernel dot_product_partial(
+    global const floatN* a,
+    global const floatN* b,
+    int N,
+    local float* local_res,
+    global float* partial
+  ) {
+    int sz = get_global_size(0);
+    int idx = get_global_id(0);
+    floatN acc0 = 0.0f;
+    floatN acc1 = 0.0f;
+    floatN acc2 = 0.0f;
+    floatN acc3 = 0.0f;
+    for (; idx + 3 * sz < N; idx += 4 * sz) {
+      acc0 = mad(a[idx], b[idx], acc0);
+      acc1 = mad(a[idx + sz], b[idx + sz], acc1);
+      acc2 = mad(a[idx + 2 * sz], b[idx + 2 * sz], acc2);
+      acc3 = mad(a[idx + 3 * sz], b[idx + 3 * sz], acc3);
+    }
+    for (; idx < N; idx += sz) {
+      acc0 = mad(a[idx], b[idx], acc0);
+    }
+    floatN acc = (acc0 + acc1) + (acc2 + acc3);
+  #if WIDTH == 8
+    float4 acc4 = acc.lo + acc.hi;
+  #else
+    float4 acc4 = acc;
+  #endif
+    local_reduce(local_res, (acc4.x + acc4.y) + (acc4.z + acc4.w));
+    if (get_local_id(0) == 0) {
+  #ifdef ACCUMULATE
+      partial[get_group_id(0)] += local_res[0];
+  #else
+      partial[get_group_id(0)] = local_res[0];
+  #endif
+    }
+  }
+
+  // Stage 2: a single work-group sums the partials, so only one float goes back to the host.
+  void kernel reduce_partials(global const float* partial, int count, local float* local_res, global float* res) {
+    float sum = 0.0f;
+    for (int idx = get_local_id(0); idx < count; idx += get_local_size(0)) {
+      sum += partial[idx];
+    }
+    local_reduce(local_res, sum);
+    if (get_local_id(0) == 0) {
+      res[0] = local_res[0];
+    }
+  }
+)OpenCL";
+
+} // namespace
+
+class Solution : public ISolution {
+public:
+  explicit Solution(int vector_width) :
+    program(build_program(vector_width)),
+    dot_product_partial(program, "dot_product_partial"),
+    reduce_partials(program, "reduce_partials"),
+    vector_width(vector_width),
+    max_work_group_size(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()),
+    compute_units(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()),
+    result_buffer(CL_MEM_WRITE_ONLY, sizeof(float)) {
+  }
+  void set_input(const std::vector<float>& a, const std::vector<float>& b) override {
+    if (a.size() != b.size()) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    if (a.size() != N) {
+      resize(a.size());
+    }
+    write(a_buffer, a);
+    write(b_buffer, b);
+  }
+  void set_a(const std::vector<float>& a) override {
+    check_size(a);
+    write(a_buffer, a);
+  }
+  void set_b(const std::vector<float>& b) override {
+    check_size(b);
+    write(b_buffer, b);
+  }
+  void run_kernel() override {
+    if (N == 0) {
+      return;
+    }
+    const auto local_res = cl::Local(work_group_size * sizeof(float));
+    // The queue is in order, the second stage starts when the first is done.
+    dot_product_partial(
+      cl::EnqueueArgs(cl::NDRange(work_group_count * work_group_size), cl::NDRange(work_group_size)),
+      a_buffer, b_buffer, static_cast<int>(vector_cnt), local_res, partial_buffer
+    );
+    reduce_partials(
+      cl::EnqueueArgs(cl::NDRange(work_group_size), cl::NDRange(work_group_size)),
+      partial_buffer, static_cast<int>(work_group_count), local_res, result_buffer
+    ).wait();
+  }
+  float get_output() override {
+    float res = 0.0f;
+    if (N != 0) {
+      enqueueReadBuffer(result_buffer, CL_TRUE, 0, sizeof(float), &res);
+    }
+    return res;
+  }
+private:
+  static cl::Program build_program(int vector_width) {
+    if (vector_width != 4 && vector_width != 8) {
+      throw std::invalid_argument("vector width must be 4 or 8");
+    }
+    cl::Program program(float_sum_source(dot_product_vectorized_kernel));
+    program.build(("-DWIDTH=" + std::to_string(vector_width)).c_str());
+    return program;
+  }
+  void resize(size_t size) {
+    N = size;
+    if (N == 0) {
+      return;
+    }
+    vector_cnt = (N + vector_width - 1) / vector_width;
+    work_group_size = floor_pow2(std::min(256uz, max_work_group_size));
+    // At least four vectors per work-item so that the unrolled loop runs.
+    work_group_count = std::max(1uz, std::min(
+      (vector_cnt + 4 * work_group_size - 1) / (4 * work_group_size),
+      4uz * compute_units
+    ));
+    const auto padded_bytes = vector_cnt * vector_width * sizeof(float);
+    a_buffer = cl::Buffer(CL_MEM_READ_ONLY, padded_bytes);
+    b_buffer = cl::Buffer(CL_MEM_READ_ONLY, padded_bytes);
+    // The padding is never written by set_a/set_b, so zeroing it once is enough.
+    const std::vector<float> zeros(vector_cnt * vector_width - N, 0.0f);
+    if (!zeros.empty()) {
+      enqueueWriteBuffer(a_buffer, CL_TRUE, N * sizeof(float), zeros.size() * sizeof(float), zeros.data());
+      enqueueWriteBuffer(b_buffer, CL_TRUE, N * sizeof(float), zeros.size() * sizeof(float), zeros.data());
+    }
+    partial_buffer = cl::Buffer(CL_MEM_READ_WRITE, work_group_count * sizeof(float));
+  }
+  void check_size(const std::vector<float>& operand) const {
+    if (operand.size() != N) {
+      throw std::invalid_argument("operand size differs from the last set_input");
+    }
+  }
+  static void write(const cl::Buffer& buffer, const std::vector<float>& data) {
+    if (!data.empty()) {
+      enqueueWriteBuffer(buffer, CL_TRUE, 0, data.size() * sizeof(float), data.data());
+    }
+  }
+
+  cl::Program program;
+  cl::KernelFunctor<cl::Buffer, cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> dot_product_partial;
+  cl::KernelFunctor<cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> reduce_partials;
+  const size_t vector_width;
+  const size_t max_work_group_size;
+  const size_t compute_units;
+  size_t N = kNotSized;
+  size_t vector_cnt = 0;
+  size_t work_group_size = 0;
+  size_t work_group_count = 0;
+  cl::Buffer a_buffer;
+  cl::Buffer b_buffer;
+  cl::Buffer partial_buffer;
+  cl::Buffer result_buffer;
+};
+
+std::unique_ptr<ISolution> solution(int vector_width) {
+  return std::make_unique<Solution>(vector_width);
+}
+
+namespace {
+
+// The streaming engine always uses float8 loads.
+constexpr size_t kStreamWidth = 8;
+// Zeros for the padding after the last chunk, a static so that non-blocking writes can read it.
+constexpr float kStreamPadding[kStreamWidth] = {};
+
+} // namespace
+
+class Streaming : public IStreamingSolution {
+public:
+  Streaming(size_t chunk_size, int depth) :
+    program(build_program(depth)),
+    dot_product_partial(program, "dot_product_partial"),
+    reduce_partials(program, "reduce_partials"),
+    upload_queue(cl::Context::getDefault(), cl::Device::getDefault()),
+    compute_queue(cl::Context::getDefault(), cl::Device::getDefault()),
+    chunk_size(clamp_chunk_size(chunk_size)),
+    work_group_size(floor_pow2(std::min(256uz, cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()))),
+    result_buffer(CL_MEM_WRITE_ONLY, sizeof(float)) {
+    // Sized for a full chunk, shorter ones leave some work-items idle.
+    const size_t compute_units = cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    work_group_count = std::max(1uz, std::min(
+      (this->chunk_size / kStreamWidth + 4 * work_group_size - 1) / (4 * work_group_size),
+      4uz * compute_units
+    ));
+    partial_buffer = cl::Buffer(CL_MEM_READ_WRITE, work_group_count * sizeof(float));
+    slots.resize(depth);
+    for (auto& slot : slots) {
+      slot.a = cl::Buffer(CL_MEM_READ_ONLY, this->chunk_size * sizeof(float));
+      slot.b = cl::Buffer(CL_MEM_READ_ONLY, this->chunk_size * sizeof(float));
+    }
+  }
+  float run(std::span<const float> a, std::span<const float> b) override {
+    if (a.size() != b.size()) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    const std::vector<float> zeros(work_group_count, 0.0f);
+    compute_queue.enqueueWriteBuffer(partial_buffer, CL_TRUE, 0, zeros.size() * sizeof(float), zeros.data());
+    const auto local_res = cl::Local(work_group_size * sizeof(float));
+    for (size_t chunk = 0, offset = 0; offset < a.size(); ++chunk, offset += chunk_size) {
+      auto& slot = slots[chunk % slots.size()];
+      const size_t size = std::min(chunk_size, a.size() - offset);
+      const size_t vector_cnt = (size + kStreamWidth - 1) / kStreamWidth;
+      const size_t padding = vector_cnt * kStreamWidth - size;
+      // The uploads wait for the kernel that last read the slot; the kernel waits for the uploads. Only the
+      // events order the two queues, the host never blocks here.
+      std::vector<cl::Event> uploaded(padding != 0 ? 4 : 2);
+      upload_queue.enqueueWriteBuffer(
+        slot.a, CL_FALSE, 0, size * sizeof(float), a.data() + offset, &slot.computed, &uploaded[0]
+      );
+      upload_queue.enqueueWriteBuffer(
+        slot.b, CL_FALSE, 0, size * sizeof(float), b.data() + offset, &slot.computed, &uploaded[1]
+      );
+      if (padding != 0) {
+        upload_queue.enqueueWriteBuffer(
+          slot.a, CL_FALSE, size * sizeof(float), padding * sizeof(float), kStreamPadding, nullptr, &uploaded[2]
+        );
+        upload_queue.enqueueWriteBuffer(
+          slot.b, CL_FALSE, size * sizeof(float), padding * sizeof(float), kStreamPadding, nullptr, &uploaded[3]
+        );
+      }
+      slot.computed = {dot_product_partial(
+        cl::EnqueueArgs(
+          compute_queue, uploaded, cl::NDRange(work_group_count * work_group_size), cl::NDRange(work_group_size)
+        ),
+        slot.a, slot.b, static_cast<int>(vector_cnt), local_res, partial_buffer
+      )};
+      // Submit now: a queue waiting on an event of the other one must not wait for a flush that never comes.
+      upload_queue.flush();
+      compute_queue.flush();
+    }
+    reduce_partials(
+      cl::EnqueueArgs(compute_queue, cl::NDRange(work_group_size), cl::NDRange(work_group_size)),
+      partial_buffer, static_cast<int>(work_group_count), local_res, result_buffer
+    );
+    float res = 0.0f;
+    compute_queue.enqueueReadBuffer(result_buffer, CL_TRUE, 0, sizeof(float), &res);
+    for (auto& slot : slots) {
+      slot.computed.clear();
+    }
+    return res;
+  }
+private:
+  // A pair of device buffers for one chunk in flight, and the kernel launch that last read them.
+  struct Slot {
+    cl::Buffer a;
+    cl::Buffer b;
+    std::vector<cl::Event> computed;
+  };
+
+  static cl::Program build_program(int depth) {
+    if (depth < 1 || depth > 3) {
+      throw std::invalid_argument("streaming depth must be 1, 2 or 3");
+    }
+    cl::Program program(float_sum_source(dot_product_vectorized_kernel));
+    program.build(("-DWIDTH=" + std::to_string(kStreamWidth) + " -DACCUMULATE").c_str());
+    return program;
+  }
+  // A whole number of vectors, no larger than the biggest buffer the device allows.
+  static size_t clamp_chunk_size(size_t chunk_size) {
+    const size_t max_floats = cl::Device::getDefault().getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>() / sizeof(float);
+    chunk_size = std::min(std::max(chunk_size, kStreamWidth), max_floats);
+    return chunk_size / kStreamWidth * kStreamWidth;
+  }
+
+  cl::Program program;
+  cl::KernelFunctor<cl::Buffer, cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> dot_product_partial;
+  cl::KernelFunctor<cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> reduce_partials;
+  cl::CommandQueue upload_queue;
+  cl::CommandQueue compute_queue;
+  const size_t chunk_size;
+  const size_t work_group_size;
+  size_t work_group_count = 0;
+  std::vector<Slot> slots;
+  cl::Buffer partial_buffer;
+  cl::Buffer result_buffer;
+};
+
+std::unique_ptr<IStreamingSolution> streaming_solution(size_t chunk_size, int depth) {
+  return std::make_unique<Streaming>(chunk_size, depth);
+}
+
+namespace {
+
+// MAX_K is passed as a build option.
+const char* batch_kernels = R"OpenCL(
+  // Work-group g computes the dot product of row g of `a` and row g of `b`. A stride of 0 for `a` compares one
+  // query against every row.
+  void kernel batch_dot(
+    global const float* a,
+    int a_stride,
+    global const float* b,
+    int dim,
+    local float* local_res,
+    global float* scores
+  ) {
+    global const float* a_row = a + (size_t)get_group_id(0) * a_stride;
+    global const float* b_row = b + (size_t)get_group_id(0) * dim;
+    float res = 0.0f;
+    for (int idx = get_local_id(0); idx < dim; idx += get_local_size(0)) {
+      res = mad(a_row[idx], b_row[idx], res);
+    }
+    local_reduce(local_res, res);
+    if (get_local_id(0) == 0) {
+      scores[get_group_id(0)] = local_res[0];
+    }
+  }
+
+  // Keeps the best k (score, row) pairs offered so far in private memory, sorted best first.
+  void top_k_insert(float* best, int* rows, int k, float score, int row) {
+    if (!(score > best[k - 1])) {
+      return;
+    }
+    int idx = k - 1;
+    for (; idx > 0 && best[idx - 1] < score; --idx) {
+      best[idx] = best[idx - 1];
+      rows[idx] = rows[idx - 1];
+    }
+    best[idx] = score;
+    rows[idx] = row;
+  }
+
+  // Merges the sorted lists of the work-items into the best k of the work-group: k rounds of an argmax over the
+  // heads of the lists, the winner moves its head on.
+  void top_k_merge(
+    const float* best,
+    const int* rows,
+    int k,
+    local float* local_score,
+    local int* local_lid,
+    global float* out_scores,
+    global int* out_rows
+  ) {
+    int lid = get_local_id(0);
+    int head = 0;
+    for (int round = 0; round < k; ++round) {
+      local_score[lid] = head < k ? best[head] : -INFINITY;
+      local_lid[lid] = lid;
+      for (int stride = get_local_size(0) / 2; stride > 0; stride /= 2) {
+        barrier(CLK_LOCAL_MEM_FENCE);
+        if (lid < stride && local_score[lid + stride] > local_score[lid]) {
+          local_score[lid] = local_score[lid + stride];
+          local_lid[lid] = local_lid[lid + stride];
+        }
+      }
+      barrier(CLK_LOCAL_MEM_FENCE);
+      if (lid == local_lid[0]) {
+        out_scores[round] = head < k ? best[head] : -INFINITY;
+        out_rows[round] = head < k ? rows[head] : -1;
+        ++head;
+      }
+      barrier(CLK_LOCAL_MEM_FENCE);
+    }
+  }
+
+  // Stage 1: every work-group writes the best k of its strided share of the scores.
+  void kernel top_k_scores(
+    global const float* scores,
+    int count,
+    int k,
+    local float* local_score,
+    local int* local_lid,
+    global float* out_scores,
+    global int* out_rows
+  ) {
+    float best[MAX_K];
+    int rows[MAX_K];
+    for (int idx = 0; idx < k; ++idx) {
+      best[idx] = -INFINITY;
+      rows[idx] = -1;
+    }
+    for (int idx = get_global_id(0); idx < count; idx += get_global_size(0)) {
+      top_k_insert(best, rows, k, scores[idx], idx);
+    }
+    int offset = get_group_id(0) * k;
+    top_k_merge(best, rows, k, local_score, local_lid, out_scores + offset, out_rows + offset);
+  }
+
+  // Stage 2: a single work-group selects the best k of the candidates of stage 1.
+  void kernel top_k_candidates(
+    global const float* scores,
+    global const int* rows_in,
+    int count,
+    int k,
+    local float* local_score,
+    local int* local_lid,
+    global float* out_scores,
+    global int* out_rows
+  ) {
+    float best[MAX_K];
+    int rows[MAX_K];
+    for (int idx = 0; idx < k; ++idx) {
+      best[idx] = -INFINITY;
+      rows[idx] = -1;
+    }
+    for (int idx = get_local_id(0); idx < count; idx += get_local_size(0)) {
+      top_k_insert(best, rows, k, scores[idx], rows_in[idx]);
+    }
+    top_k_merge(best, rows, k, local_score, local_lid, out_scores, out_rows);
+  }
+)OpenCL";
 
 } // namespace
 
-void precompile() {
-  program = cl::Program(dot_product_kernel, true);
+class Batch : public IBatchSolution {
+public:
+  Batch() :
+    program(build_program()),
+    batch_dot(program, "batch_dot"),
+    top_k_scores(program, "top_k_scores"),
+    top_k_candidates(program, "top_k_candidates"),
+    max_work_group_size(floor_pow2(std::min(256uz, cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()))),
+    compute_units(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()) {
+  }
+  std::vector<float> scores(std::span<const float> query, std::span<const float> candidates) override {
+    const size_t row_cnt = run_scores(query, candidates);
+    std::vector<float> res(row_cnt);
+    if (row_cnt != 0) {
+      enqueueReadBuffer(scores_buffer.buffer, CL_TRUE, 0, row_cnt * sizeof(float), res.data());
+    }
+    return res;
+  }
+  std::vector<float> pairs(std::span<const float> a, std::span<const float> b, size_t dim) override {
+    if (a.size() != b.size()) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    if (dim == 0 || a.size() % dim != 0) {
+      throw std::invalid_argument("operands are not a whole number of rows");
+    }
+    const size_t pair_cnt = a.size() / dim;
+    std::vector<float> res(pair_cnt);
+    if (pair_cnt != 0) {
+      launch_dot(a, dim, b, dim, pair_cnt);
+      enqueueReadBuffer(scores_buffer.buffer, CL_TRUE, 0, pair_cnt * sizeof(float), res.data());
+    }
+    return res;
+  }
+  std::vector<ScoredRow> top_k(std::span<const float> query, std::span<const float> candidates, size_t k) override {
+    if (k > kMaxTopK) {
+      throw std::invalid_argument("k is larger than kMaxTopK");
+    }
+    const size_t row_cnt = run_scores(query, candidates);
+    k = std::min(k, row_cnt);
+    if (k == 0) {
+      return {};
+    }
+    // As many work-groups as fill the device, each selects k candidates for the final work-group.
+    const size_t work_group_size = max_work_group_size;
+    const size_t group_cnt = std::min((row_cnt + work_group_size - 1) / work_group_size, 4uz * compute_units);
+    reserve(candidate_scores, group_cnt * k * sizeof(float));
+    reserve(candidate_rows, group_cnt * k * sizeof(int));
+    reserve(top_scores, k * sizeof(float));
+    reserve(top_rows, k * sizeof(int));
+    const auto local_score = cl::Local(work_group_size * sizeof(float));
+    const auto local_lid = cl::Local(work_group_size * sizeof(int));
+    top_k_scores(
+      cl::EnqueueArgs(cl::NDRange(group_cnt * work_group_size), cl::NDRange(work_group_size)),
+      scores_buffer.buffer, static_cast<int>(row_cnt), static_cast<int>(k), local_score, local_lid,
+      candidate_scores.buffer, candidate_rows.buffer
+    );
+    top_k_candidates(
+      cl::EnqueueArgs(cl::NDRange(work_group_size), cl::NDRange(work_group_size)),
+      candidate_scores.buffer, candidate_rows.buffer, static_cast<int>(group_cnt * k), static_cast<int>(k),
+      local_score, local_lid, top_scores.buffer, top_rows.buffer
+    );
+    std::vector<float> best(k);
+    std::vector<int> rows(k);
+    enqueueReadBuffer(top_scores.buffer, CL_TRUE, 0, k * sizeof(float), best.data());
+    enqueueReadBuffer(top_rows.buffer, CL_TRUE, 0, k * sizeof(int), rows.data());
+    std::vector<ScoredRow> res;
+    for (size_t idx = 0; idx < k; ++idx) {
+      // Rows scoring -inf or NaN never enter the selection.
+      if (rows[idx] >= 0) {
+        res.push_back({static_cast<uint32_t>(rows[idx]), best[idx]});
+      }
+    }
+    return res;
+  }
+private:
+  // A device buffer that is only reallocated when a call needs more than it has.
+  struct GrowingBuffer {
+    cl::Buffer buffer;
+    size_t bytes = 0;
+  };
+
+  static cl::Program build_program() {
+    cl::Program program(float_sum_source(batch_kernels));
+    program.build(("-DMAX_K=" + std::to_string(kMaxTopK)).c_str());
+    return program;
+  }
+  static void reserve(GrowingBuffer& buffer, size_t bytes) {
+    if (bytes > buffer.bytes) {
+      buffer.buffer = cl::Buffer(CL_MEM_READ_WRITE, bytes);
+      buffer.bytes = bytes;
+    }
+  }
+  static void upload(GrowingBuffer& buffer, std::span<const float> data) {
+    reserve(buffer, data.size_bytes());
+    enqueueWriteBuffer(buffer.buffer, CL_FALSE, 0, data.size_bytes(), data.data());
+  }
+  // Scores every row of `candidates` into scores_buffer, returns the row count.
+  size_t run_scores(std::span<const float> query, std::span<const float> candidates) {
+    if (query.empty() || candidates.size() % query.size() != 0) {
+      throw std::invalid_argument("candidates are not a whole number of query-sized rows");
+    }
+    const size_t row_cnt = candidates.size() / query.size();
+    if (row_cnt != 0) {
+      launch_dot(query, 0, candidates, query.size(), row_cnt);
+    }
+    return row_cnt;
+  }
+  // The uploads are non-blocking, the queue is in order and every caller ends with a blocking read, after which
+  // the host data may go away.
+  void launch_dot(std::span<const float> a, size_t a_stride, std::span<const float> b, size_t dim, size_t row_cnt) {
+    upload(a_buffer, a);
+    upload(b_buffer, b);
+    reserve(scores_buffer, row_cnt * sizeof(float));
+    // No wider than a row, short rows would leave most of the work-group idle.
+    const size_t work_group_size = floor_pow2(std::min(max_work_group_size, dim));
+    batch_dot(
+      cl::EnqueueArgs(cl::NDRange(row_cnt * work_group_size), cl::NDRange(work_group_size)),
+      a_buffer.buffer, static_cast<int>(a_stride), b_buffer.buffer, static_cast<int>(dim),
+      cl::Local(work_group_size * sizeof(float)), scores_buffer.buffer
+    );
+  }
+
+  cl::Program program;
+  cl::KernelFunctor<cl::Buffer, int, cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> batch_dot;
+  cl::KernelFunctor<cl::Buffer, int, int, cl::LocalSpaceArg, cl::LocalSpaceArg, cl::Buffer, cl::Buffer> top_k_scores;
+  cl::KernelFunctor<cl::Buffer, cl::Buffer, int, int, cl::LocalSpaceArg, cl::LocalSpaceArg, cl::Buffer, cl::Buffer>
+    top_k_candidates;
+  const size_t max_work_group_size;
+  const size_t compute_units;
+  GrowingBuffer a_buffer;
+  GrowingBuffer b_buffer;
+  GrowingBuffer scores_buffer;
+  GrowingBuffer candidate_scores;
+  GrowingBuffer candidate_rows;
+  GrowingBuffer top_scores;
+  GrowingBuffer top_rows;
+};
+
+std::unique_ptr<IBatchSolution> batch_solution() {
+  return std::make_unique<Batch>();
 }
 
-float solution(const std::vector<float>& a, const std::vector<float>& b, bool profile) {
-  if (profile) {
-    cl::CommandQueue::setDefault(cl::CommandQueue(cl::QueueProperties::Profiling));
-  }
-  const auto N = a.size();
-  const auto work_group_size = std::min({
-    N,
-    256uz,
-    cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()
-  });
-  const auto work_group_count = std::min(
-    (N + work_group_size - 1) / work_group_size,
-    4uz * cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()
-  );
-  cl::Buffer a_buffer(a.begin(), a.end(), true);
-  cl::Buffer b_buffer(b.begin(), b.end(), true);
-  const auto final_res_bytes = work_group_count * sizeof(float);
-  cl::Buffer final_res_buffer(CL_MEM_WRITE_ONLY, final_res_bytes);
-  std::chrono::high_resolution_clock::time_point clock_start;
-  if (profile) {
-    clock_start = std::chrono::high_resolution_clock::now();
-  }
-  cl::KernelFunctor<cl::Buffer, cl::Buffer, cl::LocalSpaceArg, int, cl::Buffer> dot_product(program, "dot_product");
-  auto profile_event = dot_product(
-    cl::EnqueueArgs(
-      cl::NDRange(work_group_count * work_group_size),
-      cl::NDRange(work_group_size)
-    ),
-    a_buffer, b_buffer, cl::Local(work_group_size * sizeof(float)), N, final_res_buffer
-  );
-  profile_event.wait();
-  if (profile) {
-    std::cout << "clock time: " << 
-      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - clock_start) << "\n";
-    std::cout << "profile time: " << 
-      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::nanoseconds(
-        profile_event.getProfilingInfo<CL_PROFILING_COMMAND_END>() - profile_event.getProfilingInfo<CL_PROFILING_COMMAND_START>()
-      )) << "\n";
-  }
-  std::vector<float> final_res(work_group_count);
-  enqueueReadBuffer(final_res_buffer, CL_TRUE, 0, final_res_bytes, final_res.data());
-  return std::accumulate(final_res.begin(), final_res.end(), 0.0f);
+namespace {
+
+// Built after dot_product_vectorized_kernel (WIDTH=8) for local_reduce and its reduce_partials. One of
+// FORMAT_FP16, FORMAT_BF16 or FORMAT_INT8 is defined. N counts groups of eight elements, the buffers are
+// zero-padded to whole groups.
+const char* dot_product_encoded_kernel = R"OpenCL(
+  #if defined(FORMAT_FP16)
+    // half is a storage-only type without cl_khr_fp16, vload_half8 converts to float.
+    typedef half element;
+    typedef float8 acc8;
+    acc8 multiply_add(acc8 acc, global const element* a, global const element* b, int idx) {
+      return mad(vload_half8(idx, a), vload_half8(idx, b), acc);
+    }
+  #elif defined(FORMAT_BF16)
+    typedef ushort element;
+    typedef float8 acc8;
+    float8 widen(ushort8 bits) {
+      return as_float8(convert_uint8(bits) << 16);
+    }
+    acc8 multiply_add(acc8 acc, global const element* a, global const element* b, int idx) {
+      return mad(widen(vload8(idx, a)), widen(vload8(idx, b)), acc);
+    }
+  #else
+    // A lane of a work-item overflows after about 133k products of 127 * 127, far beyond its share.
+    typedef char element;
+    typedef int8 acc8;
+    acc8 multiply_add(acc8 acc, global const element* a, global const element* b, int idx) {
+      return acc + convert_int8(vload8(idx, a)) * convert_int8(vload8(idx, b));
+    }
+  #endif
+
+  void kernel dot_product_encoded(
+    global const element* a,
+    global const element* b,
+    int N,
+    local float* local_res,
+    global float* partial
+  ) {
+    int sz = get_global_size(0);
+    int idx = get_global_id(0);
+    acc8 acc0 = 0;
+    acc8 acc1 = 0;
+    for (; idx + sz < N; idx += 2 * sz) {
+      acc0 = multiply_add(acc0, a, b, idx);
+      acc1 = multiply_add(acc1, a, b, idx + sz);
+    }
+    if (idx < N) {
+      acc0 = multiply_add(acc0, a, b, idx);
+    }
+    float8 acc = convert_float8(acc0) + convert_float8(acc1);
+    float4 acc4 = acc.lo + acc.hi;
+    local_reduce(local_res, (acc4.x + acc4.y) + (acc4.z + acc4.w));
+    if (get_local_id(0) == 0) {
+      partial[get_group_id(0)] = local_res[0];
+    }
+  }
+)OpenCL";
+
+// Elements per load of dot_product_encoded.
+constexpr size_t kEncodedWidth = 8;
+
+const char* format_define(Format format) {
+  switch (format) {
+  case Format::Fp16: return "-DFORMAT_FP16";
+  case Format::Bf16: return "-DFORMAT_BF16";
+  case Format::Int8: return "-DFORMAT_INT8";
+  }
+  return "";
+}
+
+} // namespace
+
+class Encoded : public IEncodedSolution {
+public:
+  explicit Encoded(Format format) :
+    program(build_program(format)),
+    dot_product_encoded(program, "dot_product_encoded"),
+    reduce_partials(program, "reduce_partials"),
+    format(format),
+    max_work_group_size(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>()),
+    compute_units(cl::Device::getDefault().getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>()),
+    result_buffer(CL_MEM_WRITE_ONLY, sizeof(float)) {
+  }
+  void set_input(const EncodedVector& a, const EncodedVector& b) override {
+    if (a.format != format || b.format != format) {
+      throw std::invalid_argument("operand format differs from the engine's");
+    }
+    if (a.size != b.size) {
+      throw std::invalid_argument("dot product operands differ in size");
+    }
+    if (a.size != N) {
+      resize(a.size);
+    }
+    if (N != 0) {
+      enqueueWriteBuffer(a_buffer, CL_TRUE, 0, a.data.size(), a.data.data());
+      enqueueWriteBuffer(b_buffer, CL_TRUE, 0, b.data.size(), b.data.data());
+    }
+    scale = a.scale * b.scale;
+  }
+  void run_kernel() override {
+    if (N == 0) {
+      return;
+    }
+    const auto local_res = cl::Local(work_group_size * sizeof(float));
+    dot_product_encoded(
+      cl::EnqueueArgs(cl::NDRange(work_group_count * work_group_size), cl::NDRange(work_group_size)),
+      a_buffer, b_buffer, static_cast<int>(vector_cnt), local_res, partial_buffer
+    );
+    reduce_partials(
+      cl::EnqueueArgs(cl::NDRange(work_group_size), cl::NDRange(work_group_size)),
+      partial_buffer, static_cast<int>(work_group_count), local_res, result_buffer
+    ).wait();
+  }
+  float get_output() override {
+    float res = 0.0f;
+    if (N != 0) {
+      enqueueReadBuffer(result_buffer, CL_TRUE, 0, sizeof(float), &res);
+    }
+    return res * scale;
+  }
+private:
+  static cl::Program build_program(Format format) {
+    cl::Program program(float_sum_source(std::string(dot_product_vectorized_kernel) + dot_product_encoded_kernel));
+    program.build(("-DWIDTH=" + std::to_string(kEncodedWidth) + " " + format_define(format)).c_str());
+    return program;
+  }
+  // The same launch shape as Solution, with the padding written once per size.
+  void resize(size_t size) {
+    N = size;
+    if (N == 0) {
+      return;
+    }
+    vector_cnt = (N + kEncodedWidth - 1) / kEncodedWidth;
+    work_group_size = floor_pow2(std::min(256uz, max_work_group_size));
+    work_group_count = std::max(1uz, std::min(
+      (vector_cnt + 2 * work_group_size - 1) / (2 * work_group_size),
+      4uz * compute_units
+    ));
+    const size_t bytes = element_bytes(format);
+    a_buffer = cl::Buffer(CL_MEM_READ_ONLY, vector_cnt * kEncodedWidth * bytes);
+    b_buffer = cl::Buffer(CL_MEM_READ_ONLY, vector_cnt * kEncodedWidth * bytes);
+    const std::vector<uint8_t> zeros((vector_cnt * kEncodedWidth - N) * bytes, 0);
+    if (!zeros.empty()) {
+      enqueueWriteBuffer(a_buffer, CL_TRUE, N * bytes, zeros.size(), zeros.data());
+      enqueueWriteBuffer(b_buffer, CL_TRUE, N * bytes, zeros.size(), zeros.data());
+    }
+    partial_buffer = cl::Buffer(CL_MEM_READ_WRITE, work_group_count * sizeof(float));
+  }
+
+  cl::Program program;
+  cl::KernelFunctor<cl::Buffer, cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> dot_product_encoded;
+  cl::KernelFunctor<cl::Buffer, int, cl::LocalSpaceArg, cl::Buffer> reduce_partials;
+  const Format format;
+  const size_t max_work_group_size;
+  const size_t compute_units;
+  size_t N = kNotSized;
+  size_t vector_cnt = 0;
+  size_t work_group_size = 0;
+  size_t work_group_count = 0;
+  float scale = 1.0f;
+  cl::Buffer a_buffer;
+  cl::Buffer b_buffer;
+  cl::Buffer partial_buffer;
+  cl::Buffer result_buffer;
+};
+
+std::unique_ptr<IEncodedSolution> encoded_solution(Format format) {
+  return std::make_unique<Encoded>(format);
 }
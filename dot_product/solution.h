@@ -1,5 +1,85 @@
+#pragma once
+
+#include "encoding.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
 
 float reference_solution(const std::vector<float>& a, const std::vector<float>& b);
-void precompile();
-float solution(const std::vector<float>& a, const std::vector<float>& b, bool profile = false);
+
+// Dot product engine that keeps its device buffers, kernel and launch configuration between calls, so repeated
+// queries only pay for what changed. set_a/set_b replace one operand and must keep the size of the last
+// set_input.
+class ISolution {
+public:
+  virtual ~ISolution() {};
+  virtual void set_input(const std::vector<float>& a, const std::vector<float>& b) = 0;
+  virtual void set_a(const std::vector<float>& a) = 0;
+  virtual void set_b(const std::vector<float>& b) = 0;
+  virtual void run_kernel() = 0;
+  virtual float get_output() = 0;
+};
+
+// One partial sum per work-group, summed on the host.
+std::unique_ptr<ISolution> basic_solution();
+// float4 or float8 loads with unrolled independent accumulators and a second kernel that reduces the partial
+// sums on the device, so a single float is read back.
+std::unique_ptr<ISolution> solution(int vector_width = 8);
+// Host backend without OpenCL: the vectors are split across `thread_cnt` threads (0 for one per hardware
+// thread), each running an AVX-512, AVX2-FMA or portable kernel picked by CPUID at startup.
+std::unique_ptr<ISolution> cpu_solution(size_t thread_cnt = 0);
+
+// Out-of-core engine for operands larger than device memory, e.g. memory-mapped files (see mapped_file.h).
+// They are streamed through `depth` pairs of device buffers of `chunk_size` floats: one command queue uploads
+// the next chunks while another reduces the current one, ordered by events. Depth 1 serialises upload and
+// compute, for comparison.
+class IStreamingSolution {
+public:
+  virtual ~IStreamingSolution() {};
+  virtual float run(std::span<const float> a, std::span<const float> b) = 0;
+};
+
+std::unique_ptr<IStreamingSolution> streaming_solution(size_t chunk_size = 1 << 22, int depth = 2);
+
+// A candidate row and its score against the query.
+struct ScoredRow {
+  uint32_t row;
+  float score;
+};
+
+// Many short dot products in one launch, one work-group per pair, with buffers that only grow between calls.
+// Operands are row-major: `candidates` holds rows of query.size() floats, `a` and `b` hold pairs of `dim`
+// floats back to back.
+class IBatchSolution {
+public:
+  virtual ~IBatchSolution() {};
+  // The score of `query` against every row of `candidates`.
+  virtual std::vector<float> scores(std::span<const float> query, std::span<const float> candidates) = 0;
+  // The dot product of every pair of rows of `a` and `b`.
+  virtual std::vector<float> pairs(std::span<const float> a, std::span<const float> b, size_t dim) = 0;
+  // The `k` (at most kMaxTopK) best rows of scores(), best first. Selected on the device, only they are read
+  // back.
+  virtual std::vector<ScoredRow> top_k(std::span<const float> query, std::span<const float> candidates, size_t k) = 0;
+
+  static constexpr size_t kMaxTopK = 32;
+};
+
+std::unique_ptr<IBatchSolution> batch_solution();
+
+// Dot product of operands stored as fp16, bf16 or int8 (see encoding.h), for a half or a quarter of the bytes
+// of fp32. Both operands must be in the format of the engine; products accumulate in fp32, int32 for int8,
+// and the output includes the int8 scales.
+class IEncodedSolution {
+public:
+  virtual ~IEncodedSolution() {};
+  virtual void set_input(const EncodedVector& a, const EncodedVector& b) = 0;
+  virtual void run_kernel() = 0;
+  virtual float get_output() = 0;
+};
+
+// OpenCL: float8-style loads of eight narrow elements, the two-stage reduction of solution().
+std::unique_ptr<IEncodedSolution> encoded_solution(Format format);
+// Host: the threads of cpu_solution(), with AVX2/F16C or portable kernels.
+std::unique_ptr<IEncodedSolution> encoded_cpu_solution(Format format, size_t thread_cnt = 0);
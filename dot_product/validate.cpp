@@ -1,33 +1,159 @@
 #include "solution.h"
 #include "init.h"
 #include "cl_util.h"
+#include "mapped_file.h"
+#include "reduction.h"
+#include "validate.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <print>
 
 #include <CL/cl_version.h>
 #include <CL/opencl.hpp>
 
 namespace {
-  constexpr size_t kVecSize = 100000;
-  constexpr auto kMaxError = 1e-5;
+  // Small chunks, so that the vectors take many chunks through every slot and end in a padded one.
+  constexpr size_t kStreamChunkSize = 8192;
+  // Rows shorter than a work-group and not a power of two.
+  constexpr size_t kBatchDim = 100;
+  constexpr size_t kBatchRows = 3000;
+  constexpr size_t kTopK = 10;
+
+  void write_file(const std::filesystem::path& path, const std::vector<float>& data) {
+    std::ofstream(path, std::ios::binary).write(
+      reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float)
+    );
+  }
+
+  bool validate_streaming(int depth, const char* name) {
+    const auto sol = streaming_solution(kStreamChunkSize, depth);
+    const auto [a, b] = init(kVecSize);
+    if (!check(sol->run(a, b), reference_solution(a, b), name)) {
+      return false;
+    }
+    const auto [a2, b2] = init(kVecSize / 3);
+    if (!check(sol->run(a2, b2), reference_solution(a2, b2), name)) {
+      return false;
+    }
+    // The same operands from memory-mapped files.
+    const auto dir = std::filesystem::temp_directory_path();
+    write_file(dir / "dot_product_a.bin", a);
+    write_file(dir / "dot_product_b.bin", b);
+    float res = 0.0f;
+    {
+      const MappedFile a_file(dir / "dot_product_a.bin");
+      const MappedFile b_file(dir / "dot_product_b.bin");
+      res = sol->run(a_file.floats(), b_file.floats());
+    }
+    std::filesystem::remove(dir / "dot_product_a.bin");
+    std::filesystem::remove(dir / "dot_product_b.bin");
+    return check(res, reference_solution(a, b), name);
+  }
+
+  // Every operator on the device against the host implementation. Sums compare within the tolerance, the
+  // others exactly.
+  bool validate_reductions() {
+    auto [a, b] = init(kVecSize);
+    // Two equal minima, the first one wins.
+    a[kVecSize / 3] = -1.0f;
+    a[kVecSize / 2] = -1.0f;
+    if (!check(Reduction<Dot>().run(a, b), HostReduction<Dot>().run(a, b), "reduction dot") ||
+        !check(Reduction<Dot>().run(a, b), reference_solution(a, b), "reduction dot, cached program") ||
+        !check(Reduction<SquaredNorm>().run(a), HostReduction<SquaredNorm>().run(a), "reduction squared norm")) {
+      return false;
+    }
+    if (Reduction<MaxAbs>().run(a) != HostReduction<MaxAbs>().run(a)) {
+      std::cerr << "Validation Failed (reduction max abs)." << std::endl;
+      return false;
+    }
+    const auto arg_min = Reduction<ArgMin>().run(a);
+    const auto host_arg_min = HostReduction<ArgMin>().run(a);
+    if (arg_min.value != host_arg_min.value || arg_min.index != host_arg_min.index) {
+      std::cerr << "Validation Failed (reduction arg min)." <<
+        " Result = " << arg_min.value << " at " << arg_min.index << "." <<
+        " Expected = " << host_arg_min.value << " at " << host_arg_min.index << "." << std::endl;
+      return false;
+    }
+    if (Reduction<Histogram16>().run(a) != HostReduction<Histogram16>().run(a)) {
+      std::cerr << "Validation Failed (reduction histogram)." << std::endl;
+      return false;
+    }
+    // An empty input reduces to the identity.
+    return check(Reduction<Dot>().run({}) + 1.0f, 1.0f, "reduction of nothing");
+  }
+
+  std::vector<float> row(const std::vector<float>& rows, size_t idx) {
+    return {rows.begin() + idx * kBatchDim, rows.begin() + (idx + 1) * kBatchDim};
+  }
+
+  bool validate_batch() {
+    const auto sol = batch_solution();
+    const auto [query, _] = init(kBatchDim);
+    const auto [a, b] = init(kBatchDim * kBatchRows);
+    std::vector<float> ref(kBatchRows);
+    for (size_t idx = 0; idx < kBatchRows; ++idx) {
+      ref[idx] = reference_solution(query, row(b, idx));
+    }
+    const auto scores = sol->scores(query, b);
+    for (size_t idx = 0; idx < kBatchRows; ++idx) {
+      if (!check(scores[idx], ref[idx], "batch scores")) {
+        return false;
+      }
+    }
+    const auto pairs = sol->pairs(a, b, kBatchDim);
+    for (size_t idx = 0; idx < kBatchRows; ++idx) {
+      if (!check(pairs[idx], reference_solution(row(a, idx), row(b, idx)), "batch pairs")) {
+        return false;
+      }
+    }
+    // Near-equal scores may come out in either order, so the k-th best score is compared and not the row.
+    const auto top = sol->top_k(query, b, kTopK);
+    std::vector<float> sorted = ref;
+    std::sort(sorted.begin(), sorted.end(), std::greater<>());
+    if (top.size() != kTopK) {
+      std::cerr << "Validation Failed (batch top-k). " << top.size() << " rows instead of " << kTopK << std::endl;
+      return false;
+    }
+    for (size_t idx = 0; idx < kTopK; ++idx) {
+      if (!check(top[idx].score, sorted[idx], "batch top-k") ||
+          !check(top[idx].score, ref[top[idx].row], "batch top-k")) {
+        return false;
+      }
+    }
+    return true;
+  }
 } // namespace
 
 int main() {
   try {
+    // The host backend first: it needs no OpenCL platform, and print_devices() throws without one.
+    if (!validate_cpu()) {
+      return EXIT_FAILURE;
+    }
     print_devices();
-    precompile();
-    const auto [a, b] = init(kVecSize);
-    const auto ref = reference_solution(a, b);
-    const auto sol = solution(a, b, true);
-    const auto error = std::fabs((ref - sol) / ref);
-    if (error > kMaxError) {
-      std::cerr << "Validation Failed." <<
-        " Result = " << sol << "."
-        " Expected = " << ref << "." <<
-        " Error = " << error << "." << std::endl;
+    if (!validate(*basic_solution(), "basic") || !validate(*solution(4), "float4") || !validate(*solution(8), "float8")) {
+      return EXIT_FAILURE;
+    }
+    if (!validate_streaming(1, "streaming, depth 1") || !validate_streaming(2, "streaming, depth 2") ||
+        !validate_streaming(3, "streaming, depth 3")) {
+      return EXIT_FAILURE;
+    }
+    if (!validate_batch()) {
+      return EXIT_FAILURE;
+    }
+    if (!validate_reductions()) {
       return EXIT_FAILURE;
     }
+    for (const auto format : {Format::Fp16, Format::Bf16, Format::Int8}) {
+      const std::string name = format_name(format);
+      if (!validate_encoded(*encoded_solution(format), format, name.c_str())) {
+        return EXIT_FAILURE;
+      }
+    }
     std::cout << "Validation Successful" << std::endl;
     return EXIT_SUCCESS;
   } catch (const cl::BuildError& err) {
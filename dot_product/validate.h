@@ -0,0 +1,104 @@
+#pragma once
+
+#include "solution.h"
+#include "encoding.h"
+#include "init.h"
+#include "reduction.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Checks shared by the OpenCL validator and the host-only one. Nothing here touches OpenCL.
+
+inline constexpr size_t kVecSize = 100000;
+inline constexpr auto kMaxError = 1e-5;
+
+inline bool check(float res, float ref, const char* name) {
+  const auto error = std::fabs((ref - res) / ref);
+  if (error > kMaxError) {
+    std::cerr << "Validation Failed (" << name << ")." <<
+      " Result = " << res << "."
+      " Expected = " << ref << "." <<
+      " Error = " << error << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+inline bool validate(ISolution& sol, const char* name) {
+  const auto [a, b] = init(kVecSize);
+  sol.set_input(a, b);
+  sol.run_kernel();
+  if (!check(sol.get_output(), reference_solution(a, b), name)) {
+    return false;
+  }
+  // Replacing one operand reuses the buffers of the first query.
+  const std::vector<float> b2(b.rbegin(), b.rend());
+  sol.set_b(b2);
+  sol.run_kernel();
+  if (!check(sol.get_output(), reference_solution(a, b2), name)) {
+    return false;
+  }
+  // A different size, not a multiple of the vector width, reallocates them.
+  const auto [a3, b3] = init(kVecSize / 3);
+  sol.set_input(a3, b3);
+  sol.run_kernel();
+  if (!check(sol.get_output(), reference_solution(a3, b3), name)) {
+    return false;
+  }
+  // Empty operands sum to exactly 0, which check() can not compare relative to.
+  sol.set_input({}, {});
+  sol.run_kernel();
+  if (const float res = sol.get_output(); res != 0.0f) {
+    std::cerr << "Validation Failed (" << name << ", empty operands). Result = " << res << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// The engine against the exact dot product of the decoded operands, and the encoding error against the fp32
+// reference. With the non-negative inputs of init() every product is off by at most about twice the unit
+// roundoff of the format, and so is the sum.
+inline bool validate_encoded(IEncodedSolution& sol, Format format, const char* name) {
+  const auto [a, b] = init(kVecSize);
+  const auto ea = encode(a, format);
+  const auto eb = encode(b, format);
+  sol.set_input(ea, eb);
+  sol.run_kernel();
+  const float res = sol.get_output();
+  if (!check(res, reference_solution(decode(ea), decode(eb)), name)) {
+    return false;
+  }
+  const float ref = reference_solution(a, b);
+  const auto error = std::fabs((ref - res) / ref);
+  const auto max_error = 2.0 * unit_roundoff(format) * (1.0 + unit_roundoff(format));
+  std::cout << name << ": error against fp32 " << error << " (bound " << max_error << ")" << std::endl;
+  if (error > max_error) {
+    std::cerr << "Validation Failed (" << name << ")." <<
+      " Encoding error " << error << " above " << max_error << "." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// The host backend: cpu_solution() with one, several and the default number of threads, the host reductions,
+// and encoded_cpu_solution() in every format.
+inline bool validate_cpu() {
+  if (!validate(*cpu_solution(1), "cpu, 1 thread") || !validate(*cpu_solution(3), "cpu, 3 threads") ||
+      !validate(*cpu_solution(), "cpu")) {
+    return false;
+  }
+  const auto [a, b] = init(kVecSize);
+  if (!check(HostReduction<Dot>().run(a, b), reference_solution(a, b), "host reduction dot")) {
+    return false;
+  }
+  for (const auto format : {Format::Fp16, Format::Bf16, Format::Int8}) {
+    const std::string name = "cpu " + std::string(format_name(format));
+    if (!validate_encoded(*encoded_cpu_solution(format), format, name.c_str())) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Persistent helper threads. run(f) calls f(idx) for every idx below size(), index 0 on the calling thread,
+// and returns when all calls are done.
+class Workers {
+public:
+  explicit Workers(size_t thread_cnt) : thread_cnt(thread_cnt) {
+    for (size_t idx = 1; idx < thread_cnt; ++idx) {
+      threads.emplace_back([this, idx]() {
+        work(idx);
+      });
+    }
+  }
+  Workers(const Workers&) = delete;
+  Workers& operator=(const Workers&) = delete;
+  ~Workers() {
+    stopping = true;
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+  size_t size() const {
+    return thread_cnt;
+  }
+  void run(const std::function<void(size_t)>& f) {
+    job = &f;
+    done_cnt.store(0, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    generation.notify_all();
+    f(0);
+    for (size_t done; (done = done_cnt.load(std::memory_order_acquire)) != thread_cnt - 1; ) {
+      done_cnt.wait(done, std::memory_order_acquire);
+    }
+  }
+private:
+  void work(size_t idx) {
+    for (uint64_t seen = 0; ; ) {
+      generation.wait(seen, std::memory_order_acquire);
+      seen = generation.load(std::memory_order_acquire);
+      if (stopping) {
+        return;
+      }
+      (*job)(idx);
+      if (done_cnt.fetch_add(1, std::memory_order_release) + 1 == thread_cnt - 1) {
+        done_cnt.notify_one();
+      }
+    }
+  }
+
+  const size_t thread_cnt;
+  const std::function<void(size_t)>* job = nullptr;
+  std::atomic<uint64_t> generation = 0;
+  std::atomic<size_t> done_cnt = 0;
+  bool stopping = false;
+  std::vector<std::thread> threads;
+};
+
+// `thread_cnt`, or one per hardware thread for 0.
+inline size_t default_thread_cnt(size_t thread_cnt) {
+  return thread_cnt != 0 ? thread_cnt : std::max(std::thread::hardware_concurrency(), 1u);
+}
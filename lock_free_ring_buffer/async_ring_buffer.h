@@ -0,0 +1,178 @@
+#pragma once
+
+#include "coroutine_executor.h"
+#include "mpmc_ring_buffer.h"
+#include "wait_strategy.h"
+
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Coroutine front end for MpmcRingBuffer: `co_await ring.push(val)` suspends while the buffer is full and
+// `T val = co_await ring.pop()` while it is empty, instead of polling.
+// Two counters work like semaphores: `items` counts elements a pop may take and `spaces` free slots a push
+// may fill. An operation that takes the counter below zero has registered a debt, parks its coroutine on the
+// matching lock-free waiter stack and is resumed through the executor by the operation that pays it back.
+// A woken operation owns its reservation, so its ring access can only fail transiently (a neighbouring slot
+// still being written) and is retried.
+template <typename T>
+class AsyncRingBuffer {
+    // Intrusive node of a waiter stack, lives in the awaiter inside the suspended coroutine's frame.
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        Waiter* next = nullptr;
+    };
+
+    // Lock-free stack that only supports push and taking everything at once, so there is no ABA.
+    class WaiterStack {
+    public:
+        void push(Waiter* first, Waiter* last) {
+            Waiter* top = head.load(std::memory_order_relaxed);
+            do {
+                last->next = top;
+            } while (!head.compare_exchange_weak(top, first, std::memory_order_release, std::memory_order_relaxed));
+        }
+        // Removes one waiter. Only called when a waiter is known to be on its way, so it spins until one shows up.
+        Waiter* pop_one() {
+            Waiter* list;
+            while ((list = head.exchange(nullptr, std::memory_order_acquire)) == nullptr) {
+                cpu_relax();
+            }
+            if (Waiter* rest = list->next) {
+                Waiter* last = rest;
+                while (last->next != nullptr) {
+                    last = last->next;
+                }
+                push(rest, last);
+            }
+            return list;
+        }
+    private:
+        std::atomic<Waiter*> head = nullptr;
+    };
+
+public:
+    class PopAwaiter {
+    public:
+        bool await_ready() {
+            return try_acquire(ring.items);
+        }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            if (ring.items.fetch_sub(1, std::memory_order_acquire) > 0) {
+                return false;
+            }
+            waiter.handle = handle;
+            // The coroutine may be resumed on another thread as soon as it is on the stack.
+            ring.pop_waiters.push(&waiter, &waiter);
+            return true;
+        }
+        T await_resume() {
+            T val;
+            while (!ring.buffer.try_dequeue(val)) {
+                cpu_relax();
+            }
+            ring.release(ring.spaces, ring.push_waiters);
+            return val;
+        }
+    private:
+        friend class AsyncRingBuffer;
+        explicit PopAwaiter(AsyncRingBuffer& ring) : ring(ring) {
+        }
+        AsyncRingBuffer& ring;
+        Waiter waiter;
+    };
+
+    class PushAwaiter {
+    public:
+        bool await_ready() {
+            return try_acquire(ring.spaces);
+        }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            if (ring.spaces.fetch_sub(1, std::memory_order_acquire) > 0) {
+                return false;
+            }
+            waiter.handle = handle;
+            ring.push_waiters.push(&waiter, &waiter);
+            return true;
+        }
+        void await_resume() {
+            while (!ring.buffer.enqueue(std::move(val))) {
+                cpu_relax();
+            }
+            ring.release(ring.items, ring.pop_waiters);
+        }
+    private:
+        friend class AsyncRingBuffer;
+        PushAwaiter(AsyncRingBuffer& ring, T&& val) : ring(ring), val(std::move(val)) {
+        }
+        AsyncRingBuffer& ring;
+        T val;
+        Waiter waiter;
+    };
+
+    // Suspended coroutines are resumed through `executor`. The capacity is that of MpmcRingBuffer: a power of
+    // two, at least 2.
+    AsyncRingBuffer(size_t size, IExecutor& executor) :
+        buffer(size), executor(executor), spaces(static_cast<int64_t>(buffer.capacity())) {
+    }
+    AsyncRingBuffer(const AsyncRingBuffer&) = delete;
+    AsyncRingBuffer& operator=(const AsyncRingBuffer&) = delete;
+
+    [[nodiscard]] PopAwaiter pop() {
+        return PopAwaiter(*this);
+    }
+    [[nodiscard]] PushAwaiter push(T val) {
+        return PushAwaiter(*this, std::move(val));
+    }
+    // Non-suspending variants for callers outside coroutines.
+    bool try_push(T val) {
+        if (!try_acquire(spaces)) {
+            return false;
+        }
+        while (!buffer.enqueue(std::move(val))) {
+            cpu_relax();
+        }
+        release(items, pop_waiters);
+        return true;
+    }
+    std::optional<T> try_pop() {
+        if (!try_acquire(items)) {
+            return std::nullopt;
+        }
+        std::optional<T> val;
+        while (!(val = buffer.dequeue())) {
+            cpu_relax();
+        }
+        release(spaces, push_waiters);
+        return val;
+    }
+
+private:
+    // Takes a unit of `counter` if one is available without going into debt.
+    static bool try_acquire(std::atomic<int64_t>& counter) {
+        int64_t curr = counter.load(std::memory_order_relaxed);
+        while (curr > 0) {
+            if (counter.compare_exchange_weak(curr, curr - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    // Returns a unit of `counter`, handing it straight to a waiter if somebody is in debt.
+    void release(std::atomic<int64_t>& counter, WaiterStack& waiters) {
+        if (counter.fetch_add(1, std::memory_order_release) < 0) {
+            executor.schedule(waiters.pop_one()->handle);
+        }
+    }
+
+    MpmcRingBuffer<T> buffer;
+    IExecutor& executor;
+    alignas(kCacheLineSize) std::atomic<int64_t> items = 0;
+    alignas(kCacheLineSize) std::atomic<int64_t> spaces;
+    alignas(kCacheLineSize) WaiterStack pop_waiters;
+    alignas(kCacheLineSize) WaiterStack push_waiters;
+};
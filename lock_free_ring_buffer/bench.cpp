@@ -1,41 +1,702 @@
+#include "async_ring_buffer.h"
+#include "blocking_ring_buffer.h"
+#include "broadcast_ring_buffer.h"
+#include "byte_ring_buffer.h"
 #include "lock_free_ring_buffer.h"
+#include "mpmc_ring_buffer.h"
+#include "perf_counters.h"
+#include "spsc_ring_buffer.h"
+#include "thread_team.h"
+#include "unbounded_queue.h"
+#include "wait_strategy.h"
 
-#include <barrier>
-#include <future>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <latch>
+#include <memory>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 
 constexpr size_t kSize = 111;
 constexpr size_t kElemCnt = 1234;
 
-void bench1(benchmark::State& state) {
-    LockFreeRingBuffer ring_buffer(kSize);
+// Fixed-capacity buffers are default-constructed, the rest take the requested size.
+template <typename Buffer>
+std::unique_ptr<Buffer> make_ring_buffer(size_t size) {
+    if constexpr (std::is_constructible_v<Buffer, size_t>) {
+        return std::make_unique<Buffer>(size);
+    } else {
+        return std::make_unique<Buffer>();
+    }
+}
+
+// Team of `thread_cnt` persistent threads with the given placement. Skips the benchmark and returns nullptr if
+// the placement is not available on this machine.
+std::unique_ptr<ThreadTeam> make_team(benchmark::State& state, size_t thread_cnt, Placement placement) {
+    const auto cpus = pick_cpus(thread_cnt, placement);
+    if (!cpus) {
+        state.SkipWithError((std::string(placement_name(placement)) + " placement is not available").c_str());
+        return nullptr;
+    }
+    return std::make_unique<ThreadTeam>(thread_cnt, *cpus);
+}
+
+// Adds the p50/p99/p99.9 of the recorded round trips as counters.
+void report_percentiles(benchmark::State& state, std::vector<int64_t>& round_trips_ns) {
+    if (round_trips_ns.empty()) {
+        return;
+    }
+    std::sort(round_trips_ns.begin(), round_trips_ns.end());
+    const auto percentile = [&](double p) {
+        return static_cast<double>(round_trips_ns[static_cast<size_t>(p * (round_trips_ns.size() - 1))]);
+    };
+    state.counters["p50_ns"] = percentile(0.5);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+}
+
+const std::vector<int64_t> kCapacities = {16, 256, 4096};
+const std::vector<int64_t> kPlacements = {
+    static_cast<int64_t>(Placement::SameCore),
+    static_cast<int64_t>(Placement::CrossCore),
+    static_cast<int64_t>(Placement::CrossSocket),
+};
+
+template <size_t Size>
+struct Payload {
+    Payload() = default;
+    explicit Payload(int seq) : seq(seq) {
+    }
+    int seq = 0;
+    std::array<std::byte, Size - sizeof(int)> data{};
+};
+
+// One producer and one consumer move kElemCnt Size-byte payloads through a buffer of state.range(0) elements,
+// with the two threads placed as state.range(1).
+template <typename Buffer, size_t Size>
+void bench_spsc(benchmark::State& state) {
+    PerfCounters perf;
+    const auto placement = static_cast<Placement>(state.range(1));
+    const auto team = make_team(state, 2, placement);
+    if (!team) {
+        return;
+    }
+    const auto ring_buffer_ptr = make_ring_buffer<Buffer>(state.range(0));
+    auto& ring_buffer = *ring_buffer_ptr;
+    perf.start();
     for (auto _ : state) {
-        std::vector<std::future<void>> futures;
-        std::barrier sync(2);
-        auto f1 = std::async(std::launch::async, [&]() {
-            sync.arrive_and_wait();
-            for (int i = 0; i < kElemCnt; ++i) {
-                while (!ring_buffer.enqueue(i)) {
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    while (!ring_buffer.emplace(i)) {
+                    }
+                }
+            } else {
+                Payload<Size> val;
+                for (int i = 0; i < kElemCnt; ++i) {
+                    while (!ring_buffer.try_dequeue(val)) {
+                    }
+                    benchmark::DoNotOptimize(val);
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetLabel(placement_name(placement));
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+    state.SetBytesProcessed(state.iterations() * kElemCnt * Size);
+}
+
+#define BENCH_SPSC(Buffer, Size) \
+    BENCHMARK(bench_spsc<Buffer<Payload<Size>>, Size>)->ArgsProduct({kCapacities, kPlacements}) \
+        ->ArgNames({"capacity", "placement"})->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime()
+
+BENCH_SPSC(LockFreeRingBuffer, 8);
+BENCH_SPSC(LockFreeRingBuffer, 64);
+BENCH_SPSC(LockFreeRingBuffer, 256);
+BENCH_SPSC(SpscRingBuffer, 8);
+BENCH_SPSC(SpscRingBuffer, 64);
+BENCH_SPSC(SpscRingBuffer, 256);
+BENCH_SPSC(MpmcRingBuffer, 8);
+BENCH_SPSC(MpmcRingBuffer, 64);
+BENCH_SPSC(MpmcRingBuffer, 256);
+
+// Fixed-capacity storage, the capacity argument only labels the run.
+BENCHMARK(bench_spsc<LockFreeRingBuffer<Payload<8>, 128>, 8>)->ArgsProduct({{128}, kPlacements})
+    ->ArgNames({"capacity", "placement"})->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_spsc<LockFreeRingBuffer<Payload<8>, kSize>, 8>)->ArgsProduct({{kSize}, kPlacements})
+    ->ArgNames({"capacity", "placement"})->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Round trips between two threads through a pair of buffers of state.range(0) elements: every message waits
+// for the previous reply, so each one pays for the cache line transfers between the threads in both
+// directions. The threads are placed as state.range(1); reports latency percentiles over all round trips.
+template <typename Buffer>
+void bench_ping_pong(benchmark::State& state) {
+    constexpr int kRoundTripCnt = 1000;
+    PerfCounters perf;
+    const auto placement = static_cast<Placement>(state.range(1));
+    const auto team = make_team(state, 2, placement);
+    if (!team) {
+        return;
+    }
+    const auto ping = make_ring_buffer<Buffer>(state.range(0));
+    const auto pong = make_ring_buffer<Buffer>(state.range(0));
+    std::vector<int64_t> round_trips_ns;
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            int val;
+            if (t == 0) {
+                for (int i = 0; i < kRoundTripCnt; ++i) {
+                    const auto start = std::chrono::steady_clock::now();
+                    while (!ping->enqueue(i)) {
+                    }
+                    while (!pong->try_dequeue(val)) {
+                    }
+                    round_trips_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count());
+                }
+            } else {
+                for (int i = 0; i < kRoundTripCnt; ++i) {
+                    while (!ping->try_dequeue(val)) {
+                    }
+                    while (!pong->enqueue(val)) {
+                    }
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetLabel(placement_name(placement));
+    state.SetItemsProcessed(state.iterations() * kRoundTripCnt);
+    report_percentiles(state, round_trips_ns);
+}
+
+BENCHMARK(bench_ping_pong<LockFreeRingBuffer<int>>)->ArgsProduct({{kSize}, kPlacements})
+    ->ArgNames({"capacity", "placement"})->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_ping_pong<SpscRingBuffer<int>>)->ArgsProduct({{kSize}, kPlacements})
+    ->ArgNames({"capacity", "placement"})->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_ping_pong<MpmcRingBuffer<int>>)->ArgsProduct({{kSize}, kPlacements})
+    ->ArgNames({"capacity", "placement"})->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Serializing a record: build it on the stack and copy it into the buffer...
+template <size_t Size>
+void bench_copy(benchmark::State& state) {
+    PerfCounters perf;
+    LockFreeRingBuffer<Payload<Size>> ring_buffer(kSize);
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    Payload<Size> val(i);
+                    std::memset(val.data.data(), i, val.data.size());
+                    while (!ring_buffer.enqueue(val)) {
+                    }
+                }
+            } else {
+                Payload<Size> val;
+                for (int i = 0; i < kElemCnt; ++i) {
+                    while (!ring_buffer.try_dequeue(val)) {
+                    }
+                    benchmark::DoNotOptimize(val.data[Size / 2]);
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+    state.SetBytesProcessed(state.iterations() * kElemCnt * Size);
+}
+
+// ...versus writing it straight into the claimed slot and reading it in place.
+template <size_t Size>
+void bench_zero_copy(benchmark::State& state) {
+    PerfCounters perf;
+    LockFreeRingBuffer<Payload<Size>> ring_buffer(kSize);
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    Payload<Size>* val;
+                    while ((val = ring_buffer.try_claim()) == nullptr) {
+                    }
+                    val->seq = i;
+                    std::memset(val->data.data(), i, val->data.size());
+                    ring_buffer.commit();
+                }
+            } else {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    const Payload<Size>* val;
+                    while ((val = ring_buffer.peek()) == nullptr) {
+                    }
+                    benchmark::DoNotOptimize(val->data[Size / 2]);
+                    ring_buffer.release();
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+    state.SetBytesProcessed(state.iterations() * kElemCnt * Size);
+}
+
+BENCHMARK(bench_copy<1024>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_zero_copy<1024>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_copy<4096>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_zero_copy<4096>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Move-only handles: the buffer only transfers ownership, the allocation is done by the producer.
+void bench_unique_ptr(benchmark::State& state) {
+    PerfCounters perf;
+    LockFreeRingBuffer<std::unique_ptr<int>> ring_buffer(kSize);
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    auto val = std::make_unique<int>(i);
+                    while (!ring_buffer.enqueue(std::move(val))) {
+                    }
+                }
+            } else {
+                std::unique_ptr<int> val;
+                for (int i = 0; i < kElemCnt; ++i) {
+                    while (!ring_buffer.try_dequeue(val)) {
+                    }
+                    benchmark::DoNotOptimize(*val);
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+}
+
+BENCHMARK(bench_unique_ptr)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Moves kBulkElemCnt elements in batches of state.range(0) through enqueue_bulk/dequeue_bulk.
+void bench_bulk(benchmark::State& state) {
+    constexpr size_t kBulkSize = 1024;
+    constexpr size_t kBulkElemCnt = 1 << 16;
+    PerfCounters perf;
+    const size_t batch = state.range(0);
+    std::vector<int> vals(kBulkElemCnt);
+    for (int i = 0; i < kBulkElemCnt; ++i) {
+        vals[i] = i;
+    }
+    LockFreeRingBuffer<int> ring_buffer(kBulkSize);
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    perf.start();
+    for (auto _ : state) {
+        std::vector<int> dequeued(kBulkElemCnt);
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (size_t i = 0; i < kBulkElemCnt; ) {
+                    i += ring_buffer.enqueue_bulk(std::span<const int>(vals).subspan(i, std::min(batch, kBulkElemCnt - i)));
+                }
+            } else {
+                for (size_t i = 0; i < kBulkElemCnt; ) {
+                    i += ring_buffer.dequeue_bulk(std::span<int>(dequeued).subspan(i, std::min(batch, kBulkElemCnt - i)));
                 }
             }
         });
-        std::vector<int> dequeued(kElemCnt);
-        auto f2 = std::async(std::launch::async, [&]() {
-            sync.arrive_and_wait();
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kBulkElemCnt);
+}
+
+BENCHMARK(bench_bulk)->Arg(1)->Arg(8)->Arg(64)->Arg(512)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// One producer delivers kFanoutElemCnt 64-byte messages to each of state.range(0) consumers through a single
+// BroadcastRingBuffer; the consumers read in batches with consume().
+void bench_broadcast(benchmark::State& state) {
+    constexpr size_t kFanoutSize = 1024;
+    constexpr size_t kFanoutElemCnt = 1 << 16;
+    PerfCounters perf;
+    const size_t consumer_cnt = state.range(0);
+    const auto team = make_team(state, consumer_cnt + 1, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    perf.start();
+    for (auto _ : state) {
+        BroadcastRingBuffer<Payload<64>> ring_buffer(kFanoutSize);
+        std::vector<BroadcastRingBuffer<Payload<64>>::Consumer*> consumers;
+        for (size_t c = 0; c < consumer_cnt; ++c) {
+            consumers.push_back(&ring_buffer.add_consumer());
+        }
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < kFanoutElemCnt; ++i) {
+                    Payload<64>* val;
+                    while ((val = ring_buffer.try_claim()) == nullptr) {
+                    }
+                    val->seq = i;
+                    ring_buffer.commit();
+                }
+            } else {
+                for (size_t received = 0; received < kFanoutElemCnt; ) {
+                    received += consumers[t - 1]->consume([](const Payload<64>& val) {
+                        benchmark::DoNotOptimize(val.seq);
+                    });
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kFanoutElemCnt * consumer_cnt);
+}
+
+// The same fan-out done by copying every message into state.range(0) separate LockFreeRingBuffers.
+void bench_fanout_copies(benchmark::State& state) {
+    constexpr size_t kFanoutSize = 1024;
+    constexpr size_t kFanoutElemCnt = 1 << 16;
+    PerfCounters perf;
+    const size_t consumer_cnt = state.range(0);
+    const auto team = make_team(state, consumer_cnt + 1, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    std::vector<std::unique_ptr<LockFreeRingBuffer<Payload<64>>>> ring_buffers;
+    for (size_t c = 0; c < consumer_cnt; ++c) {
+        ring_buffers.push_back(std::make_unique<LockFreeRingBuffer<Payload<64>>>(kFanoutSize));
+    }
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (int i = 0; i < kFanoutElemCnt; ++i) {
+                    const Payload<64> val(i);
+                    for (auto& ring_buffer : ring_buffers) {
+                        while (!ring_buffer->enqueue(val)) {
+                        }
+                    }
+                }
+            } else {
+                Payload<64> val;
+                for (size_t received = 0; received < kFanoutElemCnt; ) {
+                    if (ring_buffers[t - 1]->try_dequeue(val)) {
+                        benchmark::DoNotOptimize(val.seq);
+                        ++received;
+                    }
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kFanoutElemCnt * consumer_cnt);
+}
+
+BENCHMARK(bench_broadcast)->Arg(1)->Arg(2)->Arg(3)->Arg(4)->ArgName("consumers")->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_fanout_copies)->Arg(1)->Arg(2)->Arg(3)->Arg(4)->ArgName("consumers")->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+enum class MessageSizes { Small, Large, Uniform, Bimodal };
+
+// Sizes of `message_cnt` messages: all 16 bytes, all 4 KB, uniform in between, or 90% 64 bytes and 10% 4 KB.
+std::vector<size_t> message_sizes(MessageSizes dist, size_t message_cnt) {
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<size_t> uniform(16, 4096);
+    std::bernoulli_distribution large(0.1);
+    std::vector<size_t> sizes(message_cnt);
+    for (auto& size : sizes) {
+        switch (dist) {
+        case MessageSizes::Small: size = 16; break;
+        case MessageSizes::Large: size = 4096; break;
+        case MessageSizes::Uniform: size = uniform(gen); break;
+        case MessageSizes::Bimodal: size = large(gen) ? 4096 : 64; break;
+        }
+    }
+    return sizes;
+}
+
+// Streams variable-length messages through a 256 KB ByteRingBuffer, the size distribution is state.range(0).
+// The producer fills each claimed record, the consumer reads it in place.
+void bench_byte_ring(benchmark::State& state) {
+    constexpr size_t kCapacity = 256 * 1024;
+    constexpr size_t kMessageCnt = 1 << 16;
+    static constexpr const char* kLabels[] = {"16B", "4KB", "uniform 16B-4KB", "bimodal 64B/4KB"};
+    PerfCounters perf;
+    const auto dist = static_cast<MessageSizes>(state.range(0));
+    const auto sizes = message_sizes(dist, kMessageCnt);
+    size_t total_bytes = 0;
+    for (const size_t size : sizes) {
+        total_bytes += size;
+    }
+    ByteRingBuffer ring_buffer(kCapacity);
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            if (t == 0) {
+                for (size_t i = 0; i < kMessageCnt; ++i) {
+                    std::optional<std::span<std::byte>> payload;
+                    while (!(payload = ring_buffer.claim(sizes[i]))) {
+                    }
+                    std::memset(payload->data(), static_cast<int>(i), payload->size());
+                    ring_buffer.commit();
+                }
+            } else {
+                for (size_t i = 0; i < kMessageCnt; ++i) {
+                    std::optional<std::span<const std::byte>> payload;
+                    while (!(payload = ring_buffer.peek())) {
+                    }
+                    benchmark::DoNotOptimize(payload->back());
+                    ring_buffer.release();
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetLabel(kLabels[state.range(0)]);
+    state.SetItemsProcessed(state.iterations() * kMessageCnt);
+    state.SetBytesProcessed(state.iterations() * total_bytes);
+}
+
+BENCHMARK(bench_byte_ring)
+    ->DenseRange(static_cast<int>(MessageSizes::Small), static_cast<int>(MessageSizes::Bimodal))
+    ->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// state.range(1) producers push kElemCnt elements each through a buffer of state.range(0) elements and
+// state.range(2) consumers drain it, with all threads placed as state.range(3).
+void bench_mpmc(benchmark::State& state) {
+    PerfCounters perf;
+    const size_t producer_cnt = state.range(1);
+    const size_t consumer_cnt = state.range(2);
+    const size_t total_cnt = producer_cnt * kElemCnt;
+    const auto placement = static_cast<Placement>(state.range(3));
+    const auto team = make_team(state, producer_cnt + consumer_cnt, placement);
+    if (!team) {
+        return;
+    }
+    MpmcRingBuffer<int> ring_buffer(state.range(0));
+    perf.start();
+    for (auto _ : state) {
+        std::atomic<size_t> dequeued_cnt = 0;
+        team->run([&](size_t t) {
+            if (t < producer_cnt) {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    while (!ring_buffer.enqueue(i)) {
+                    }
+                }
+            } else {
+                int val;
+                while (dequeued_cnt.load(std::memory_order_relaxed) < total_cnt) {
+                    if (ring_buffer.try_dequeue(val)) {
+                        dequeued_cnt.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetLabel(placement_name(placement));
+    state.SetItemsProcessed(state.iterations() * total_cnt);
+}
+
+BENCHMARK(bench_mpmc)
+    ->ArgsProduct({kCapacities, {1, 2, 4}, {1, 2, 4}, kPlacements})
+    ->ArgNames({"capacity", "producers", "consumers", "placement"})
+    ->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Bursty load: state.range(0) producers push kElemCnt * 16 elements each as fast as they can while a single
+// consumer does some work per element. A bounded buffer stalls the producers once it fills up, an unbounded
+// queue absorbs the burst; producer_ms is the time until the last producer is done.
+template <typename Buffer>
+void bench_burst(benchmark::State& state) {
+    constexpr size_t kBurstElemCnt = kElemCnt * 16;
+    constexpr int kConsumerWork = 16;
+    PerfCounters perf;
+    const size_t producer_cnt = state.range(0);
+    const size_t total_cnt = producer_cnt * kBurstElemCnt;
+    const auto team = make_team(state, producer_cnt + 1, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    const auto ring_buffer = make_ring_buffer<Buffer>(kSize);
+    std::chrono::duration<double, std::milli> producer_time{0};
+    perf.start();
+    for (auto _ : state) {
+        std::atomic<size_t> producers_left = producer_cnt;
+        const auto start = std::chrono::steady_clock::now();
+        team->run([&](size_t t) {
+            if (t < producer_cnt) {
+                for (int i = 0; i < kBurstElemCnt; ++i) {
+                    while (!ring_buffer->enqueue(i)) {
+                    }
+                }
+                if (producers_left.fetch_sub(1) == 1) {
+                    producer_time += std::chrono::steady_clock::now() - start;
+                }
+            } else {
+                int val;
+                for (size_t i = 0; i < total_cnt; ) {
+                    if (ring_buffer->try_dequeue(val)) {
+                        ++i;
+                        for (int w = 0; w < kConsumerWork; ++w) {
+                            cpu_relax();
+                        }
+                    }
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.counters["producer_ms"] = benchmark::Counter(producer_time.count(), benchmark::Counter::kAvgIterations);
+    state.SetItemsProcessed(state.iterations() * total_cnt);
+}
+
+BENCHMARK(bench_burst<MpmcRingBuffer<int>>)->Arg(1)->Arg(2)->Arg(4)->ArgName("producers")
+    ->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_burst<UnboundedQueue<int>>)->Arg(1)->Arg(2)->Arg(4)->ArgName("producers")
+    ->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Throughput of the blocking push/pop pair, CPU time shows how much the waiting side burns.
+template <typename WaitStrategy>
+void bench_wait_throughput(benchmark::State& state) {
+    PerfCounters perf;
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    BlockingRingBuffer<int, WaitStrategy> ring_buffer(kSize);
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
             for (int i = 0; i < kElemCnt; ++i) {
-                std::optional<int> val;
-                do {
-                    val = ring_buffer.dequeue();
-                } while (!val.has_value());
-                dequeued[i] = *val;
+                if (t == 0) {
+                    ring_buffer.push(i);
+                } else {
+                    benchmark::DoNotOptimize(ring_buffer.pop());
+                }
             }
         });
-        f1.wait();
-        f2.wait();
     }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+}
+
+BENCHMARK(bench_wait_throughput<SpinWait>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_wait_throughput<BackoffWait>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_wait_throughput<ParkWait>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Ping-pong through two buffers: every message waits for the previous reply, so the buffers are mostly empty
+// and each pop goes through the wait strategy. Reports round trip percentiles.
+template <typename WaitStrategy>
+void bench_wait_latency(benchmark::State& state) {
+    constexpr int kRoundTripCnt = 1000;
+    PerfCounters perf;
+    const auto team = make_team(state, 2, Placement::CrossCore);
+    if (!team) {
+        return;
+    }
+    BlockingRingBuffer<int, WaitStrategy> ping(kSize);
+    BlockingRingBuffer<int, WaitStrategy> pong(kSize);
+    std::vector<int64_t> round_trips_ns;
+    perf.start();
+    for (auto _ : state) {
+        team->run([&](size_t t) {
+            for (int i = 0; i < kRoundTripCnt; ++i) {
+                if (t == 0) {
+                    const auto start = std::chrono::steady_clock::now();
+                    ping.push(i);
+                    benchmark::DoNotOptimize(pong.pop());
+                    round_trips_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count());
+                } else {
+                    pong.push(ping.pop());
+                }
+            }
+        });
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kRoundTripCnt);
+    report_percentiles(state, round_trips_ns);
+}
+
+BENCHMARK(bench_wait_latency<SpinWait>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_wait_latency<BackoffWait>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_wait_latency<ParkWait>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+Task ping_async(AsyncRingBuffer<int>& ping, AsyncRingBuffer<int>& pong, int round_trip_cnt, std::latch& done) {
+    for (int i = 0; i < round_trip_cnt; ++i) {
+        co_await ping.push(i);
+        benchmark::DoNotOptimize(co_await pong.pop());
+    }
+    done.count_down();
+}
+
+Task echo_async(AsyncRingBuffer<int>& ping, AsyncRingBuffer<int>& pong, int round_trip_cnt, std::latch& done) {
+    for (int i = 0; i < round_trip_cnt; ++i) {
+        co_await pong.push(co_await ping.pop());
+    }
+    done.count_down();
+}
+
+// Coroutine ping-pong through two AsyncRingBuffers: every pop suspends until the other coroutine replies.
+// With the single-threaded executor a round trip is two suspend/resume pairs on one thread, with the thread pool
+// the coroutines are resumed on its two threads through the waiter stacks and the executor queue.
+template <typename Executor>
+void bench_async_ping_pong(benchmark::State& state) {
+    constexpr int kRoundTripCnt = 1000;
+    PerfCounters perf;
+    std::unique_ptr<Executor> executor;
+    if constexpr (std::is_same_v<Executor, ThreadPoolExecutor>) {
+        executor = std::make_unique<Executor>(2);
+    } else {
+        executor = std::make_unique<Executor>();
+    }
+    // Every iteration leaves both buffers empty, so they and the executor threads are reused; only the
+    // coroutines and the latch are per iteration.
+    AsyncRingBuffer<int> ping(kSize, *executor);
+    AsyncRingBuffer<int> pong(kSize, *executor);
+    std::chrono::nanoseconds total_elapsed{0};
+    perf.start();
+    for (auto _ : state) {
+        std::latch done(2);
+        const auto start = std::chrono::steady_clock::now();
+        echo_async(ping, pong, kRoundTripCnt, done).start(*executor);
+        ping_async(ping, pong, kRoundTripCnt, done).start(*executor);
+        if constexpr (std::is_same_v<Executor, SingleThreadedExecutor>) {
+            executor->run();
+        }
+        done.wait();
+        total_elapsed += std::chrono::steady_clock::now() - start;
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kRoundTripCnt);
+    state.counters["round_trip_ns"] = static_cast<double>(total_elapsed.count()) / (state.iterations() * kRoundTripCnt);
 }
 
-BENCHMARK(bench1)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_async_ping_pong<SingleThreadedExecutor>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_async_ping_pong<ThreadPoolExecutor>)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
 
 BENCHMARK_MAIN();
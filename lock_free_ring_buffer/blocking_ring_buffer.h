@@ -0,0 +1,68 @@
+#pragma once
+
+#include "mpmc_ring_buffer.h"
+#include "ring_storage.h"
+#include "wait_strategy.h"
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+// Adds blocking push/pop to one of the non-blocking buffers. WaitStrategy decides what a blocked thread does
+// (see wait_strategy.h), the try_* calls never block. The default MpmcRingBuffer allows any number of
+// producers and consumers, a SpscRingBuffer or LockFreeRingBuffer may be plugged in for one of each.
+template <typename T, typename WaitStrategy, typename Buffer = MpmcRingBuffer<T>>
+class BlockingRingBuffer {
+public:
+    explicit BlockingRingBuffer(size_t size) : buffer(size) {
+    }
+    template <typename... Args>
+    void emplace(Args&&... args) {
+        // A failed emplace leaves the arguments untouched, so they can be forwarded again.
+        not_full.wait_until([&]() {
+            return buffer.emplace(std::forward<Args>(args)...);
+        });
+        not_empty.notify();
+    }
+    void push(const T& val) {
+        emplace(val);
+    }
+    void push(T&& val) {
+        emplace(std::move(val));
+    }
+    void pop(T& val) {
+        not_empty.wait_until([&]() {
+            return buffer.try_dequeue(val);
+        });
+        not_full.notify();
+    }
+    T pop() {
+        std::optional<T> res;
+        not_empty.wait_until([&]() {
+            res = buffer.dequeue();
+            return res.has_value();
+        });
+        not_full.notify();
+        return std::move(*res);
+    }
+    bool try_push(const T& val) {
+        return notify_if(buffer.enqueue(val), not_empty);
+    }
+    bool try_push(T&& val) {
+        return notify_if(buffer.enqueue(std::move(val)), not_empty);
+    }
+    bool try_pop(T& val) {
+        return notify_if(buffer.try_dequeue(val), not_full);
+    }
+private:
+    static bool notify_if(bool done, WaitStrategy& waiters) {
+        if (done) {
+            waiters.notify();
+        }
+        return done;
+    }
+    Buffer buffer;
+    // Producers wait on not_full and consumers on not_empty, keep the two apart.
+    alignas(kCacheLineSize) WaitStrategy not_empty;
+    alignas(kCacheLineSize) WaitStrategy not_full;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "ring_storage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Single-producer multicast ring in the style of the LMAX Disruptor: every registered consumer sees every
+// element. Elements are preallocated and overwritten in place; each consumer only advances its own cursor
+// (the number of elements it has finished with), and the producer may reuse a slot once every consumer is past
+// it. A consumer can depend on other consumers, e.g. a strategy that must only see what the journal has
+// already written; it then reads up to the slowest of its dependencies instead of up to the producer.
+// Consumers must be added before the first element is published.
+template <typename T>
+class BroadcastRingBuffer {
+public:
+    class Consumer {
+    public:
+        Consumer(const Consumer&) = delete;
+        Consumer& operator=(const Consumer&) = delete;
+
+        // Returns the next element in place, or nullptr if nothing new is available. The element stays
+        // valid until release().
+        const T* peek() {
+            const uint64_t curr = cursor.load(std::memory_order_relaxed);
+            if (curr == cached_limit && (cached_limit = limit()) == curr) {
+                return nullptr;
+            }
+            return &ring.slots[curr & ring.mask];
+        }
+        void release() {
+            cursor.store(cursor.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+        bool try_dequeue(T& val) {
+            const T* elem = peek();
+            if (elem == nullptr) {
+                return false;
+            }
+            val = *elem;
+            release();
+            return true;
+        }
+        // Calls f(elem) for up to max_cnt available elements and releases them with a single cursor update,
+        // which is how a Disruptor consumer catches up after falling behind. Returns the number processed.
+        template <typename F>
+        size_t consume(F f, size_t max_cnt = std::numeric_limits<size_t>::max()) {
+            const uint64_t curr = cursor.load(std::memory_order_relaxed);
+            if (curr == cached_limit) {
+                cached_limit = limit();
+            }
+            const uint64_t end = curr + std::min<uint64_t>(cached_limit - curr, max_cnt);
+            for (uint64_t seq = curr; seq != end; ++seq) {
+                f(std::as_const(ring.slots[seq & ring.mask]));
+            }
+            cursor.store(end, std::memory_order_release);
+            return end - curr;
+        }
+
+    private:
+        friend class BroadcastRingBuffer;
+        Consumer(BroadcastRingBuffer& ring, std::vector<const std::atomic<uint64_t>*> barrier) :
+            ring(ring), barrier(std::move(barrier)) {
+        }
+        // Everything up to the slowest cursor this consumer waits for is readable.
+        uint64_t limit() const {
+            uint64_t res = barrier[0]->load(std::memory_order_acquire);
+            for (size_t i = 1; i < barrier.size(); ++i) {
+                res = std::min(res, barrier[i]->load(std::memory_order_acquire));
+            }
+            return res;
+        }
+
+        alignas(kCacheLineSize) std::atomic<uint64_t> cursor{0};
+        uint64_t cached_limit = 0;
+        BroadcastRingBuffer& ring;
+        // The producer's cursor, or the cursors of the consumers this one depends on.
+        const std::vector<const std::atomic<uint64_t>*> barrier;
+    };
+
+    // The capacity is rounded up to a power of two.
+    explicit BroadcastRingBuffer(size_t size) : mask(std::bit_ceil(size) - 1), slots(std::make_unique<T[]>(mask + 1)) {
+    }
+    BroadcastRingBuffer(const BroadcastRingBuffer&) = delete;
+    BroadcastRingBuffer& operator=(const BroadcastRingBuffer&) = delete;
+
+    // Registers a consumer that sees an element only after every consumer in `depends_on` has released it.
+    // Not thread-safe, call it before producing.
+    Consumer& add_consumer(std::initializer_list<const Consumer*> depends_on = {}) {
+        std::vector<const std::atomic<uint64_t>*> barrier;
+        for (const Consumer* dependency : depends_on) {
+            barrier.push_back(&dependency->cursor);
+        }
+        if (barrier.empty()) {
+            barrier.push_back(&published);
+        }
+        consumers.push_back(std::unique_ptr<Consumer>(new Consumer(*this, std::move(barrier))));
+        // Consumers that others depend on are never behind their dependents, so the producer only needs
+        // to gate on the ends of the dependency chains.
+        for (const Consumer* dependency : depends_on) {
+            std::erase(gating, &dependency->cursor);
+        }
+        gating.push_back(&consumers.back()->cursor);
+        return *consumers.back();
+    }
+
+    // Returns the next slot for the producer to overwrite in place, or nullptr if the slowest consumer is still
+    // a whole lap behind. The slot holds whatever was published there a lap ago.
+    T* try_claim() {
+        const uint64_t curr = published.load(std::memory_order_relaxed);
+        if (curr - cached_gate > mask && (cached_gate = gate()) + mask < curr) {
+            return nullptr;
+        }
+        return &slots[curr & mask];
+    }
+    // Publishes the slot returned by the last successful try_claim() to all consumers.
+    void commit() {
+        published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        T* slot = try_claim();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = T(std::forward<Args>(args)...);
+        commit();
+        return true;
+    }
+    bool enqueue(const T& val) {
+        return emplace(val);
+    }
+    bool enqueue(T&& val) {
+        return emplace(std::move(val));
+    }
+
+private:
+    uint64_t gate() const {
+        uint64_t res = published.load(std::memory_order_relaxed);
+        for (const auto* cursor : gating) {
+            res = std::min(res, cursor->load(std::memory_order_acquire));
+        }
+        return res;
+    }
+
+    const size_t mask;
+    const std::unique_ptr<T[]> slots;
+    std::vector<std::unique_ptr<Consumer>> consumers;
+    std::vector<const std::atomic<uint64_t>*> gating;
+    alignas(kCacheLineSize) std::atomic<uint64_t> published{0};
+    uint64_t cached_gate = 0;
+};
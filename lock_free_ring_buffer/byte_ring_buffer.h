@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ring_storage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+// Single-producer single-consumer ring of variable-length messages. Records are stored back to back as an
+// 8-byte header with the payload length followed by the payload, padded to kRecordAlignment. A record never
+// wraps around: if it does not fit before the end of the buffer, the producer writes a padding marker there
+// and starts the record at offset 0.
+// Head and tail are free-running byte counters, kept on separate cache lines like in SpscRingBuffer.
+class ByteRingBuffer {
+public:
+    static constexpr size_t kRecordAlignment = 8;
+
+    // The capacity in bytes is rounded up to a power of two (and at least one cache line).
+    explicit ByteRingBuffer(size_t capacity) :
+        mask(std::bit_ceil(std::max(capacity, kCacheLineSize)) - 1),
+        buffer(std::make_unique<Header[]>((mask + 1) / sizeof(Header))) {
+    }
+    ByteRingBuffer(const ByteRingBuffer&) = delete;
+    ByteRingBuffer& operator=(const ByteRingBuffer&) = delete;
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+    // Largest payload a single record can hold.
+    size_t max_message_size() const {
+        return capacity() / 2 - sizeof(Header);
+    }
+
+    // Reserves room for a `size`-byte message and returns the payload bytes to write it into, or std::nullopt if
+    // the buffer does not have enough free space right now. Nothing is visible to the consumer until commit().
+    // Throws std::length_error if the message can never fit.
+    std::optional<std::span<std::byte>> claim(size_t size) {
+        if (size > max_message_size()) {
+            throw std::length_error("ByteRingBuffer: message of " + std::to_string(size) + " bytes exceeds " +
+                std::to_string(max_message_size()));
+        }
+        const uint64_t curr_tail = tail.load(std::memory_order_relaxed);
+        const size_t offset = curr_tail & mask;
+        const size_t until_end = capacity() - offset;
+        const size_t record_bytes = record_size(size);
+        const size_t padding = record_bytes > until_end ? until_end : 0;
+        if (!has_room(curr_tail, padding + record_bytes)) {
+            return std::nullopt;
+        }
+        if (padding != 0) {
+            header_at(offset)->size = kPaddingMarker;
+        }
+        claimed_tail = curr_tail + padding;
+        claimed_size = size;
+        return std::span<std::byte>(payload_at(claimed_tail & mask), size);
+    }
+    // Publishes the last claimed record.
+    void commit() {
+        commit(claimed_size);
+    }
+    // Publishes the last claimed record with its payload shrunk to `size` bytes, for messages whose final length
+    // is only known after serializing them.
+    void commit(size_t size) {
+        header_at(claimed_tail & mask)->size = static_cast<uint32_t>(std::min(size, claimed_size));
+        tail.store(claimed_tail + record_size(std::min(size, claimed_size)), std::memory_order_release);
+    }
+    // Copies `msg` in as one record, returns false if there is no room.
+    bool try_write(std::span<const std::byte> msg) {
+        const auto payload = claim(msg.size());
+        if (!payload) {
+            return false;
+        }
+        std::memcpy(payload->data(), msg.data(), msg.size());
+        commit();
+        return true;
+    }
+
+    // Returns the payload of the oldest record in place, or std::nullopt if the buffer is empty. The record
+    // stays valid until release().
+    std::optional<std::span<const std::byte>> peek() {
+        uint64_t curr_head = head.load(std::memory_order_relaxed);
+        while (true) {
+            if (curr_head == cached_tail) {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (curr_head == cached_tail) {
+                    return std::nullopt;
+                }
+            }
+            const size_t offset = curr_head & mask;
+            const uint32_t size = header_at(offset)->size;
+            if (size != kPaddingMarker) {
+                peeked_head = curr_head;
+                peeked_size = size;
+                return std::span<const std::byte>(payload_at(offset), size);
+            }
+            // Skip the unused end of the buffer, the record itself starts at offset 0.
+            curr_head += capacity() - offset;
+        }
+    }
+    // Frees the record returned by the last peek().
+    void release() {
+        head.store(peeked_head + record_size(peeked_size), std::memory_order_release);
+    }
+
+private:
+    struct alignas(kRecordAlignment) Header {
+        uint32_t size;
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Header) == kRecordAlignment);
+    static constexpr uint32_t kPaddingMarker = ~uint32_t{0};
+
+    static size_t record_size(size_t size) {
+        return (sizeof(Header) + size + kRecordAlignment - 1) / kRecordAlignment * kRecordAlignment;
+    }
+    bool has_room(uint64_t curr_tail, size_t bytes) {
+        if (curr_tail + bytes - cached_head > capacity()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (curr_tail + bytes - cached_head > capacity()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    Header* header_at(size_t offset) {
+        return buffer.get() + offset / sizeof(Header);
+    }
+    std::byte* payload_at(size_t offset) {
+        return reinterpret_cast<std::byte*>(header_at(offset) + 1);
+    }
+
+    const size_t mask;
+    // Byte storage, allocated as headers so that every record offset is suitably aligned.
+    const std::unique_ptr<Header[]> buffer;
+    // Producer side.
+    alignas(kCacheLineSize) std::atomic<uint64_t> tail{0};
+    uint64_t cached_head = 0;
+    uint64_t claimed_tail = 0;
+    size_t claimed_size = 0;
+    // Consumer side.
+    alignas(kCacheLineSize) std::atomic<uint64_t> head{0};
+    uint64_t cached_tail = 0;
+    uint64_t peeked_head = 0;
+    size_t peeked_size = 0;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "unbounded_queue.h"
+#include "wait_strategy.h"
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Where suspended coroutines are resumed. AsyncRingBuffer hands every coroutine it wakes up to an executor
+// instead of resuming it on the waking thread.
+class IExecutor {
+public:
+    virtual ~IExecutor() = default;
+    virtual void schedule(std::coroutine_handle<> handle) = 0;
+};
+
+// Resumes coroutines on the thread that calls run(). Not thread-safe: schedule() may only be called from
+// that thread, i.e. from the coroutines themselves.
+class SingleThreadedExecutor : public IExecutor {
+public:
+    void schedule(std::coroutine_handle<> handle) override {
+        ready.push_back(handle);
+    }
+    // Runs until no coroutine is ready; suspended coroutines that nobody will wake up are left alone.
+    void run() {
+        while (!ready.empty()) {
+            const auto handle = ready.front();
+            ready.pop_front();
+            handle.resume();
+        }
+    }
+private:
+    std::deque<std::coroutine_handle<>> ready;
+};
+
+// Resumes coroutines on a fixed set of threads that share one UnboundedQueue of ready coroutines and park
+// in a ParkWait when it is empty.
+class ThreadPoolExecutor : public IExecutor {
+public:
+    explicit ThreadPoolExecutor(size_t thread_cnt) {
+        for (size_t i = 0; i < thread_cnt; ++i) {
+            threads.emplace_back([this]() { run(); });
+        }
+    }
+    ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+    // Coroutines that are still queued are not resumed.
+    ~ThreadPoolExecutor() {
+        stop.store(true);
+        for (size_t i = 0; i < threads.size(); ++i) {
+            not_empty.notify();
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    void schedule(std::coroutine_handle<> handle) override {
+        ready.enqueue(handle);
+        not_empty.notify();
+    }
+private:
+    void run() {
+        while (true) {
+            std::coroutine_handle<> handle;
+            bool stopped = false;
+            not_empty.wait_until([&]() {
+                if (ready.try_dequeue(handle)) {
+                    return true;
+                }
+                stopped = stop.load();
+                return stopped;
+            });
+            if (stopped) {
+                return;
+            }
+            handle.resume();
+        }
+    }
+    UnboundedQueue<std::coroutine_handle<>> ready;
+    ParkWait not_empty;
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> threads;
+};
+
+// Fire-and-forget coroutine. It does not run until start() hands it to an executor and frees its frame when
+// it finishes. Exceptions escaping the coroutine terminate the program.
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() {
+            return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {
+        }
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    Task(Task&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {
+    }
+    Task& operator=(Task&&) = delete;
+    ~Task() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+    void start(IExecutor& executor) && {
+        executor.schedule(std::exchange(handle, nullptr));
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {
+    }
+    std::coroutine_handle<promise_type> handle;
+};
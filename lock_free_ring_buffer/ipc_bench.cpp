@@ -0,0 +1,204 @@
+#include "perf_counters.h"
+#include "shm_region.h"
+#include "shm_ring_buffer.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <system_error>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr size_t kSize = 1024;
+constexpr size_t kElemCnt = 1 << 16;
+
+template <size_t Size>
+struct Message {
+    int64_t seq;
+    std::array<std::byte, Size - sizeof(int64_t)> data;
+};
+
+constexpr int64_t kStop = -1;
+// Failed spins between checks whether the peer process is still alive.
+constexpr uint32_t kLivenessCheckInterval = 1 << 12;
+
+// Region with two buffers: requests from the benchmark process to the child and replies back.
+// The child maps the memfd a second time, so both buffers are attached at different addresses.
+template <typename T>
+class Channel {
+public:
+    explicit Channel(bool huge_pages) :
+        region(SharedMemoryRegion::create_memfd("ipc_bench", 2 * stride(), huge_pages)),
+        requests(ShmRingBuffer<T>::create(region.data(), stride(), kSize)),
+        replies(ShmRingBuffer<T>::create(static_cast<std::byte*>(region.data()) + stride(), stride(), kSize)) {
+    }
+    // Forks the peer process, which runs `serve(requests, replies)` until it receives kStop. The child never
+    // returns into the benchmark runner: it exits with EXIT_FAILURE if attaching or serving throws.
+    template <typename Serve>
+    void start(Serve serve) {
+        child = fork();
+        if (child == -1) {
+            throw std::system_error(errno, std::generic_category(), "fork");
+        }
+        if (child == 0) {
+            try {
+                const auto mirror = SharedMemoryRegion::attach_fd(dup(region.fd()));
+                auto child_requests = ShmRingBuffer<T>::attach(mirror.data(), stride());
+                auto child_replies =
+                    ShmRingBuffer<T>::attach(static_cast<std::byte*>(mirror.data()) + stride(), stride());
+                serve(child_requests, child_replies);
+            } catch (...) {
+                _exit(EXIT_FAILURE);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    void stop() {
+        T msg{};
+        msg.seq = kStop;
+        if (send(msg)) {
+            waitpid(child, nullptr, 0);
+            child = -1;
+        }
+    }
+    // Spin until the message is queued to the child or a reply from it arrives. Return false once the child
+    // has exited, which it only does early on failure, instead of spinning forever.
+    bool send(const T& msg) {
+        for (uint32_t spins = 1; !requests.enqueue(msg); ++spins) {
+            if (spins % kLivenessCheckInterval == 0 && !peer_alive()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool receive(T& msg) {
+        for (uint32_t spins = 1; !replies.try_dequeue(msg); ++spins) {
+            if (spins % kLivenessCheckInterval == 0 && !peer_alive()) {
+                return false;
+            }
+        }
+        return true;
+    }
+private:
+    // Reaps the child if it has exited.
+    bool peer_alive() {
+        if (child != -1 && waitpid(child, nullptr, WNOHANG) == child) {
+            child = -1;
+        }
+        return child != -1;
+    }
+
+    static size_t stride() {
+        const auto bytes = ShmRingBuffer<T>::region_size(kSize);
+        return (bytes + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+    }
+    SharedMemoryRegion region;
+    ShmRingBuffer<T> requests;
+    ShmRingBuffer<T> replies;
+    pid_t child = -1;
+};
+
+// Skips the benchmark if the region can not be created, e.g. when no huge pages are reserved.
+template <typename T>
+std::unique_ptr<Channel<T>> open_channel(benchmark::State& state) {
+    try {
+        return std::make_unique<Channel<T>>(state.range(0) != 0);
+    } catch (const std::system_error& err) {
+        state.SkipWithError(err.what());
+        return nullptr;
+    }
+}
+
+// Streams kElemCnt messages to the child, which acknowledges every full batch with one reply.
+template <size_t Size>
+void bench_ipc_throughput(benchmark::State& state) {
+    PerfCounters perf;
+    using Msg = Message<Size>;
+    const auto channel_ptr = open_channel<Msg>(state);
+    if (channel_ptr == nullptr) {
+        return;
+    }
+    auto& channel = *channel_ptr;
+    channel.start([](ShmRingBuffer<Msg>& requests, ShmRingBuffer<Msg>& replies) {
+        Msg msg;
+        for (size_t received = 0; ; ) {
+            while (!requests.try_dequeue(msg)) {
+            }
+            if (msg.seq == kStop) {
+                return;
+            }
+            if (++received % kElemCnt == 0) {
+                while (!replies.enqueue(msg)) {
+                }
+            }
+        }
+    });
+    Msg msg{};
+    perf.start();
+    for (auto _ : state) {
+        bool ok = true;
+        for (size_t i = 0; ok && i < kElemCnt; ++i) {
+            msg.seq = static_cast<int64_t>(i);
+            ok = channel.send(msg);
+        }
+        if (!ok || !channel.receive(msg)) {
+            state.SkipWithError("the peer process exited");
+            break;
+        }
+    }
+    perf.report(state);
+    channel.stop();
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+    state.SetBytesProcessed(state.iterations() * kElemCnt * Size);
+}
+
+// The child echoes every message, each iteration is one round trip between the two processes.
+template <size_t Size>
+void bench_ipc_ping_pong(benchmark::State& state) {
+    PerfCounters perf;
+    using Msg = Message<Size>;
+    const auto channel_ptr = open_channel<Msg>(state);
+    if (channel_ptr == nullptr) {
+        return;
+    }
+    auto& channel = *channel_ptr;
+    channel.start([](ShmRingBuffer<Msg>& requests, ShmRingBuffer<Msg>& replies) {
+        Msg msg;
+        while (true) {
+            while (!requests.try_dequeue(msg)) {
+            }
+            if (msg.seq == kStop) {
+                return;
+            }
+            while (!replies.enqueue(msg)) {
+            }
+        }
+    });
+    Msg msg{};
+    perf.start();
+    for (auto _ : state) {
+        if (!channel.send(msg) || !channel.receive(msg)) {
+            state.SkipWithError("the peer process exited");
+            break;
+        }
+        ++msg.seq;
+    }
+    perf.report(state);
+    channel.stop();
+}
+
+} // namespace
+
+// The argument selects hugetlbfs backing, which needs reserved huge pages (vm.nr_hugepages).
+BENCHMARK(bench_ipc_throughput<64>)->Arg(0)->Arg(1)->ArgName("huge_pages")->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(bench_ipc_throughput<256>)->Arg(0)->Arg(1)->ArgName("huge_pages")->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(bench_ipc_ping_pong<64>)->Arg(0)->Arg(1)->ArgName("huge_pages")->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+BENCHMARK_MAIN();
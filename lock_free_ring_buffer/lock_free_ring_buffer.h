@@ -1,40 +1,151 @@
+#pragma once
+
+#include "ring_storage.h"
+
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <optional>
-#include <vector>
+#include <span>
+#include <utility>
 
+// Head, tail and the empty flag share one atomic word. The element is written before the tail CAS, so the
+// buffer supports a single producer and a single consumer; use MpmcRingBuffer for several of either.
+// With the default Capacity the size is given at run time and rounded up to a power of two, otherwise the
+// slots are stored inline (see RingStorage).
+template <typename T, size_t Capacity = kDynamicCapacity>
 class LockFreeRingBuffer {
 public:
-    explicit LockFreeRingBuffer(size_t size) : buffer(size), state() {
+    explicit LockFreeRingBuffer(size_t size) requires (Capacity == kDynamicCapacity) : buffer(size), state() {
+    }
+    LockFreeRingBuffer() requires (Capacity != kDynamicCapacity) : state() {
+    }
+    LockFreeRingBuffer(const LockFreeRingBuffer&) = delete;
+    LockFreeRingBuffer& operator=(const LockFreeRingBuffer&) = delete;
+    ~LockFreeRingBuffer() {
+        const State curr_state = state.load();
+        if (curr_state.is_empty) {
+            return;
+        }
+        size_t idx = curr_state.head;
+        do {
+            std::destroy_at(buffer[idx].ptr());
+            idx = buffer.wrap(idx + 1);
+        } while (idx != curr_state.tail);
     }
-    bool enqueue(int val) {
+    // Constructs the element directly in the tail slot. The arguments are left untouched if the buffer is full.
+    template <typename... Args>
+    bool emplace(Args&&... args) {
         State curr_state = state.load();
         const bool is_full = curr_state.head == curr_state.tail && !curr_state.is_empty;
         if (is_full) {
             return false;
         }
-        buffer[curr_state.tail] = val;
-        State new_state;
-        do {
-            new_state = curr_state;
-            new_state.tail = (new_state.tail + 1) % buffer.size();
-            new_state.is_empty = false;
-        } while (!state.compare_exchange_weak(curr_state, new_state));
+        buffer[curr_state.tail].construct(std::forward<Args>(args)...);
+        push_tail(curr_state, 1);
         return true;
     }
-    std::optional<int> dequeue() {
+    bool enqueue(const T& val) {
+        return emplace(val);
+    }
+    bool enqueue(T&& val) {
+        return emplace(std::move(val));
+    }
+    // Moves the head element into `val`, which avoids materializing an std::optional on the hot path.
+    bool try_dequeue(T& val) {
+        State curr_state = state.load();
+        if (curr_state.is_empty) {
+            return false;
+        }
+        T* elem = buffer[curr_state.head].ptr();
+        val = std::move(*elem);
+        std::destroy_at(elem);
+        pop_head(curr_state, 1);
+        return true;
+    }
+    std::optional<T> dequeue() {
         State curr_state = state.load();
         if (curr_state.is_empty) {
             return std::nullopt;
         }
-        const int res = buffer[curr_state.head];
-        State new_state;
-        do {
-            new_state = curr_state;
-            new_state.head = (new_state.head + 1) % buffer.size();
-            new_state.is_empty = new_state.head == new_state.tail;
-        } while (!state.compare_exchange_weak(curr_state, new_state));
+        T* elem = buffer[curr_state.head].ptr();
+        std::optional<T> res(std::move(*elem));
+        std::destroy_at(elem);
+        pop_head(curr_state, 1);
         return res;
     }
+    // Zero-copy producer path: default-constructs an element in the tail slot and returns it so that the payload
+    // can be written in place, or returns nullptr if the buffer is full. The element becomes visible to the
+    // consumer only after commit(). Claims do not nest and must not interleave with other enqueue calls.
+    T* try_claim() {
+        const State curr_state = state.load();
+        const bool is_full = curr_state.head == curr_state.tail && !curr_state.is_empty;
+        if (is_full) {
+            return nullptr;
+        }
+        return buffer[curr_state.tail].default_construct();
+    }
+    // Publishes the element returned by the last successful try_claim().
+    void commit() {
+        push_tail(state.load(), 1);
+    }
+    // Zero-copy consumer path: returns the head element in place, or nullptr if the buffer is empty.
+    // The slot stays owned by the consumer until release().
+    T* peek() {
+        const State curr_state = state.load();
+        if (curr_state.is_empty) {
+            return nullptr;
+        }
+        return buffer[curr_state.head].ptr();
+    }
+    // Destroys the element returned by peek() and hands its slot back to the producer.
+    void release() {
+        const State curr_state = state.load();
+        std::destroy_at(buffer[curr_state.head].ptr());
+        pop_head(curr_state, 1);
+    }
+    // Copies as many leading elements of `vals` as there is room for and publishes them with a single
+    // state update. Returns the number of elements enqueued.
+    size_t enqueue_bulk(std::span<const T> vals) {
+        State curr_state = state.load();
+        const size_t cnt = std::min(vals.size(), free_cnt(curr_state));
+        if (cnt == 0) {
+            return 0;
+        }
+        // The claimed range wraps around at most once.
+        const size_t first_cnt = std::min<size_t>(cnt, buffer.capacity() - curr_state.tail);
+        std::uninitialized_copy_n(vals.begin(), first_cnt, buffer[curr_state.tail].raw());
+        try {
+            std::uninitialized_copy_n(vals.begin() + first_cnt, cnt - first_cnt, buffer[0].raw());
+        } catch (...) {
+            std::destroy_n(buffer[curr_state.tail].ptr(), first_cnt);
+            throw;
+        }
+        push_tail(curr_state, cnt);
+        return cnt;
+    }
+    // Moves up to `vals.size()` elements into `vals` and releases their slots with a single state update.
+    // Returns the number of elements dequeued.
+    size_t dequeue_bulk(std::span<T> vals) {
+        State curr_state = state.load();
+        const size_t cnt = std::min(vals.size(), used_cnt(curr_state));
+        if (cnt == 0) {
+            return 0;
+        }
+        const size_t first_cnt = std::min<size_t>(cnt, buffer.capacity() - curr_state.head);
+        T* first = buffer[curr_state.head].ptr();
+        std::move(first, first + first_cnt, vals.begin());
+        std::destroy_n(first, first_cnt);
+        if (first_cnt < cnt) {
+            T* second = buffer[0].ptr();
+            std::move(second, second + (cnt - first_cnt), vals.begin() + first_cnt);
+            std::destroy_n(second, cnt - first_cnt);
+        }
+        pop_head(curr_state, cnt);
+        return cnt;
+    }
 private:
     struct State {
         uint64_t head : 31;
@@ -44,6 +155,34 @@ private:
     };
     static_assert(sizeof(State) == sizeof(uint64_t), "State size is not 8 bytes");
     static_assert(std::atomic<State>::is_always_lock_free, "State is not lock-free");
-    std::vector<int> buffer;
-    std::atomic<State> state;
+    size_t used_cnt(State curr_state) const {
+        if (curr_state.is_empty) {
+            return 0;
+        }
+        const size_t cnt = buffer.wrap(curr_state.tail + buffer.capacity() - curr_state.head);
+        return cnt == 0 ? buffer.capacity() : cnt;
+    }
+    size_t free_cnt(State curr_state) const {
+        return buffer.capacity() - used_cnt(curr_state);
+    }
+    // Only the producer moves the tail, so the retry loop just merges in the consumer's head updates.
+    void push_tail(State curr_state, size_t cnt) {
+        State new_state;
+        do {
+            new_state = curr_state;
+            new_state.tail = buffer.wrap(new_state.tail + cnt);
+            new_state.is_empty = false;
+        } while (!state.compare_exchange_weak(curr_state, new_state));
+    }
+    void pop_head(State curr_state, size_t cnt) {
+        State new_state;
+        do {
+            new_state = curr_state;
+            new_state.head = buffer.wrap(new_state.head + cnt);
+            new_state.is_empty = new_state.head == new_state.tail;
+        } while (!state.compare_exchange_weak(curr_state, new_state));
+    }
+    static_assert(Capacity == kDynamicCapacity || Capacity < (1u << 31), "Capacity does not fit into State");
+    RingStorage<T, Capacity> buffer;
+    alignas(kCacheLineSize) std::atomic<State> state;
 };
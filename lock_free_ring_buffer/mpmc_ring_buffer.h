@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ring_storage.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's design) with the same interface as
+// LockFreeRingBuffer. Every slot carries a sequence number that tells whose turn it is:
+// pos      - free, waiting for the producer that claims position `pos`,
+// pos + 1  - holds the element written at `pos`, waiting for its consumer.
+// Producers and consumers claim positions with a CAS on their own counter and then only touch their slot,
+// so claims for different slots never contend on a shared word.
+template <typename T>
+class MpmcRingBuffer {
+public:
+    // The capacity is rounded up to a power of two so that positions map to slots with a mask, and to at least
+    // two: with a single slot the sequence of a full cell (pos + 1) equals the next producer's position, so it
+    // would look free and get overwritten.
+    explicit MpmcRingBuffer(size_t size) :
+        mask(std::bit_ceil(std::max<size_t>(size, 2)) - 1), buffer(std::make_unique<Cell[]>(mask + 1)) {
+        for (size_t i = 0; i <= mask; ++i) {
+            buffer[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+    MpmcRingBuffer(const MpmcRingBuffer&) = delete;
+    MpmcRingBuffer& operator=(const MpmcRingBuffer&) = delete;
+    ~MpmcRingBuffer() {
+        const size_t tail = enqueue_pos.load(std::memory_order_relaxed);
+        for (size_t pos = dequeue_pos.load(std::memory_order_relaxed); pos != tail; ++pos) {
+            std::destroy_at(buffer[pos & mask].slot.ptr());
+        }
+    }
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &buffer[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // The slot still holds the element from the previous lap.
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->slot.construct(std::forward<Args>(args)...);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    bool enqueue(const T& val) {
+        return emplace(val);
+    }
+    bool enqueue(T&& val) {
+        return emplace(std::move(val));
+    }
+    size_t capacity() const {
+        return mask + 1;
+    }
+    bool try_dequeue(T& val) {
+        size_t pos;
+        Cell* cell = claim_head(pos);
+        if (cell == nullptr) {
+            return false;
+        }
+        T* elem = cell->slot.ptr();
+        val = std::move(*elem);
+        release_head(cell, pos);
+        return true;
+    }
+    std::optional<T> dequeue() {
+        size_t pos;
+        Cell* cell = claim_head(pos);
+        if (cell == nullptr) {
+            return std::nullopt;
+        }
+        std::optional<T> res(std::move(*cell->slot.ptr()));
+        release_head(cell, pos);
+        return res;
+    }
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        RingSlot<T> slot;
+    };
+    Cell* claim_head(size_t& pos) {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+        while (true) {
+            Cell* cell = &buffer[pos & mask];
+            const size_t seq = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return cell;
+                }
+            } else if (diff < 0) {
+                // Nothing has been written at this position yet.
+                return nullptr;
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    // Hands the slot over to the producer of the next lap.
+    void release_head(Cell* cell, size_t pos) {
+        std::destroy_at(cell->slot.ptr());
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+    }
+    const size_t mask;
+    const std::unique_ptr<Cell[]> buffer;
+    alignas(kCacheLineSize) std::atomic<size_t> enqueue_pos{0};
+    alignas(kCacheLineSize) std::atomic<size_t> dequeue_pos{0};
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "cpu_utils.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <new>
+#include <utility>
+
+// Uninitialized storage for one ring element, the owning buffer tracks which slots hold live objects.
+// An array of slots has the layout of a plain T array, so runs of slots can be copied in one go.
+template <typename T>
+struct RingSlot {
+    alignas(T) std::byte storage[sizeof(T)];
+    template <typename... Args>
+    void construct(Args&&... args) {
+        std::construct_at(raw(), std::forward<Args>(args)...);
+    }
+    // Default-initializes the element, so trivial members are left for the caller to fill in.
+    T* default_construct() {
+        return ::new (static_cast<void*>(storage)) T;
+    }
+    // Address of the storage, for constructing objects into it.
+    T* raw() {
+        return reinterpret_cast<T*>(storage);
+    }
+    T* ptr() {
+        return std::launder(raw());
+    }
+};
+
+// Capacity value that selects a slot array sized at run time, like std::dynamic_extent for std::span.
+inline constexpr size_t kDynamicCapacity = std::numeric_limits<size_t>::max();
+
+// Slot array of a ring buffer with a capacity fixed at compile time, stored inline and cache-line aligned.
+// Power-of-two capacities wrap indices with a mask, others with a division by a constant.
+template <typename T, size_t Capacity = kDynamicCapacity>
+class RingStorage {
+public:
+    static constexpr size_t capacity() {
+        return Capacity;
+    }
+    size_t wrap(size_t idx) const {
+        if constexpr (std::has_single_bit(Capacity)) {
+            return idx & (Capacity - 1);
+        } else {
+            return idx % Capacity;
+        }
+    }
+    RingSlot<T>& operator[](size_t idx) {
+        return slots[idx];
+    }
+private:
+    alignas(kCacheLineSize) std::array<RingSlot<T>, Capacity> slots;
+};
+
+// Heap-allocated slot array, the requested size is rounded up to a power of two so indices wrap with a mask.
+template <typename T>
+class RingStorage<T, kDynamicCapacity> {
+public:
+    explicit RingStorage(size_t size) :
+        mask(std::bit_ceil(std::max<size_t>(size, 1)) - 1),
+        slots(std::make_unique<RingSlot<T>[]>(mask + 1)) {
+    }
+    size_t capacity() const {
+        return mask + 1;
+    }
+    size_t wrap(size_t idx) const {
+        return idx & mask;
+    }
+    RingSlot<T>& operator[](size_t idx) {
+        return slots[idx];
+    }
+private:
+    size_t mask;
+    std::unique_ptr<RingSlot<T>[]> slots;
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Shared memory mapping for ShmRingBuffer. The region is backed either by an anonymous memfd, which is
+// handed to the other process by fork() or over a unix socket, or by a named POSIX shm object.
+// Errors are reported as std::system_error.
+class SharedMemoryRegion {
+public:
+    static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+    // Creates an anonymous region. With huge_pages the size is rounded up to kHugePageSize and the memory comes
+    // from the hugetlbfs pool, which must have enough pages reserved (vm.nr_hugepages).
+    static SharedMemoryRegion create_memfd(const char* name, size_t size, bool huge_pages = false) {
+        const unsigned flags = MFD_CLOEXEC | (huge_pages ? MFD_HUGETLB : 0u);
+        const int fd = memfd_create(name, flags);
+        if (fd == -1) {
+            throw_errno("memfd_create");
+        }
+        return SharedMemoryRegion(fd, huge_pages ? round_up(size, kHugePageSize) : size, true, {});
+    }
+    // Creates (or truncates) the named object /dev/shm/<name>; the creator unlinks it on destruction.
+    // shm objects can not use hugetlbfs, with huge_pages the mapping is only advised to use transparent huge pages.
+    static SharedMemoryRegion create_shm(const std::string& name, size_t size, bool huge_pages = false) {
+        const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd == -1) {
+            throw_errno("shm_open");
+        }
+        SharedMemoryRegion region(fd, size, true, name);
+        if (huge_pages) {
+            madvise(region.addr, region.len, MADV_HUGEPAGE);
+        }
+        return region;
+    }
+    // Maps an existing named object with its current size.
+    static SharedMemoryRegion attach_shm(const std::string& name) {
+        const int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd == -1) {
+            throw_errno("shm_open");
+        }
+        return SharedMemoryRegion(fd, 0, false, {});
+    }
+    // Maps the region behind a file descriptor received from another process, the region takes ownership of fd.
+    static SharedMemoryRegion attach_fd(int fd) {
+        return SharedMemoryRegion(fd, 0, false, {});
+    }
+
+    SharedMemoryRegion(SharedMemoryRegion&& other) noexcept :
+        fd_(std::exchange(other.fd_, -1)),
+        addr(std::exchange(other.addr, nullptr)),
+        len(std::exchange(other.len, 0)),
+        unlink_name(std::move(other.unlink_name)) {
+        other.unlink_name.clear();
+    }
+    SharedMemoryRegion& operator=(SharedMemoryRegion&& other) noexcept {
+        if (this != &other) {
+            release();
+            fd_ = std::exchange(other.fd_, -1);
+            addr = std::exchange(other.addr, nullptr);
+            len = std::exchange(other.len, 0);
+            unlink_name = std::move(other.unlink_name);
+            other.unlink_name.clear();
+        }
+        return *this;
+    }
+    ~SharedMemoryRegion() {
+        release();
+    }
+
+    void* data() const {
+        return addr;
+    }
+    size_t size() const {
+        return len;
+    }
+    int fd() const {
+        return fd_;
+    }
+
+private:
+    // With size == 0 the region is attached with the size of the underlying object, otherwise it is resized first.
+    SharedMemoryRegion(int fd, size_t size, bool resize, std::string unlink_name) : fd_(fd), unlink_name(std::move(unlink_name)) {
+        try {
+            if (resize) {
+                if (ftruncate(fd_, static_cast<off_t>(size)) == -1) {
+                    throw_errno("ftruncate");
+                }
+            } else {
+                struct stat st;
+                if (fstat(fd_, &st) == -1) {
+                    throw_errno("fstat");
+                }
+                size = static_cast<size_t>(st.st_size);
+            }
+            void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (ptr == MAP_FAILED) {
+                throw_errno("mmap");
+            }
+            addr = ptr;
+            len = size;
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+    void release() {
+        if (addr != nullptr) {
+            munmap(addr, len);
+            addr = nullptr;
+        }
+        if (fd_ != -1) {
+            close(fd_);
+            fd_ = -1;
+        }
+        if (!unlink_name.empty()) {
+            shm_unlink(unlink_name.c_str());
+            unlink_name.clear();
+        }
+    }
+    static size_t round_up(size_t size, size_t alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    }
+    [[noreturn]] static void throw_errno(const char* what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    int fd_ = -1;
+    void* addr = nullptr;
+    size_t len = 0;
+    std::string unlink_name;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "ring_storage.h"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+// Single-producer single-consumer ring buffer whose control block and slots live in a caller-supplied memory
+// region, typically a SharedMemoryRegion mapped by two processes. The region holds no pointers: head and tail
+// are free-running counters and every process computes slot addresses from its own mapping, so the region may
+// be mapped at different addresses. Only trivially copyable payloads can cross the process boundary.
+// The object itself is a process-local view; one process creates the buffer, the other attaches to it.
+template <typename T>
+class ShmRingBuffer {
+    static_assert(std::is_trivially_copyable_v<T>, "ShmRingBuffer payload must be trivially copyable");
+public:
+    // Bytes of the region needed for `capacity` elements; the capacity is rounded up to a power of two.
+    static size_t region_size(size_t capacity) {
+        return sizeof(Header) + std::bit_ceil(capacity) * sizeof(T);
+    }
+    // Lays out a fresh buffer in `region`, which must be aligned to kCacheLineSize.
+    static ShmRingBuffer create(void* region, size_t region_bytes, size_t capacity) {
+        capacity = std::bit_ceil(capacity);
+        check_region(region, region_bytes, capacity);
+        Header* header = ::new (region) Header;
+        header->version = kVersion;
+        header->elem_size = sizeof(T);
+        header->elem_align = alignof(T);
+        header->capacity = capacity;
+        header->tail.store(0, std::memory_order_relaxed);
+        header->head.store(0, std::memory_order_relaxed);
+        // Attaching processes only look at the layout once the magic number is visible.
+        header->magic.store(kMagic, std::memory_order_release);
+        return ShmRingBuffer(header);
+    }
+    // Attaches to a buffer created by create(), possibly in another process. Throws std::runtime_error if the
+    // region was not initialized or was laid out by a different version or for a different payload type.
+    static ShmRingBuffer attach(void* region, size_t region_bytes) {
+        if (region_bytes < sizeof(Header)) {
+            throw std::runtime_error("ShmRingBuffer: region is smaller than the control block");
+        }
+        Header* header = std::launder(static_cast<Header*>(region));
+        if (header->magic.load(std::memory_order_acquire) != kMagic) {
+            throw std::runtime_error("ShmRingBuffer: region is not initialized");
+        }
+        if (header->version != kVersion) {
+            throw std::runtime_error("ShmRingBuffer: layout version " + std::to_string(header->version) +
+                ", expected " + std::to_string(kVersion));
+        }
+        if (header->elem_size != sizeof(T) || header->elem_align != alignof(T)) {
+            throw std::runtime_error("ShmRingBuffer: payload size/alignment " + std::to_string(header->elem_size) + "/" +
+                std::to_string(header->elem_align) + ", expected " + std::to_string(sizeof(T)) + "/" + std::to_string(alignof(T)));
+        }
+        check_region(region, region_bytes, header->capacity);
+        return ShmRingBuffer(header);
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+    bool enqueue(const T& val) {
+        const uint64_t curr_tail = header->tail.load(std::memory_order_relaxed);
+        if (curr_tail - cached_head == capacity()) {
+            cached_head = header->head.load(std::memory_order_acquire);
+            if (curr_tail - cached_head == capacity()) {
+                return false;
+            }
+        }
+        std::memcpy(&slots[curr_tail & mask], &val, sizeof(T));
+        header->tail.store(curr_tail + 1, std::memory_order_release);
+        return true;
+    }
+    bool try_dequeue(T& val) {
+        const uint64_t curr_head = header->head.load(std::memory_order_relaxed);
+        if (curr_head == cached_tail) {
+            cached_tail = header->tail.load(std::memory_order_acquire);
+            if (curr_head == cached_tail) {
+                return false;
+            }
+        }
+        std::memcpy(&val, &slots[curr_head & mask], sizeof(T));
+        header->head.store(curr_head + 1, std::memory_order_release);
+        return true;
+    }
+    std::optional<T> dequeue() {
+        T val;
+        if (!try_dequeue(val)) {
+            return std::nullopt;
+        }
+        return val;
+    }
+
+private:
+    static constexpr uint64_t kMagic = 0x5348'4d52'494e'4742; // "SHMRINGB"
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header {
+        std::atomic<uint64_t> magic;
+        uint32_t version;
+        uint32_t elem_size;
+        uint32_t elem_align;
+        uint64_t capacity;
+        // Producer side.
+        alignas(kCacheLineSize) std::atomic<uint64_t> tail;
+        // Consumer side.
+        alignas(kCacheLineSize) std::atomic<uint64_t> head;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared counters must be address-free");
+    static_assert(alignof(T) <= alignof(Header), "Payload alignment exceeds the control block alignment");
+
+    static void check_region(void* region, size_t region_bytes, uint64_t capacity) {
+        if (reinterpret_cast<uintptr_t>(region) % alignof(Header) != 0) {
+            throw std::runtime_error("ShmRingBuffer: region is not cache-line aligned");
+        }
+        if (!std::has_single_bit(capacity) || region_bytes < region_size(capacity)) {
+            throw std::runtime_error("ShmRingBuffer: region of " + std::to_string(region_bytes) +
+                " bytes does not fit " + std::to_string(capacity) + " elements");
+        }
+    }
+    explicit ShmRingBuffer(Header* header) :
+        header(header),
+        slots(reinterpret_cast<T*>(reinterpret_cast<std::byte*>(header) + sizeof(Header))),
+        mask(header->capacity - 1),
+        cached_head(header->head.load(std::memory_order_acquire)),
+        cached_tail(header->tail.load(std::memory_order_acquire)) {
+    }
+
+    Header* header;
+    T* slots;
+    size_t mask;
+    // Process-local copies of the other side's counter.
+    uint64_t cached_head;
+    uint64_t cached_tail;
+};
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ring_storage.h"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Single-producer single-consumer counterpart of LockFreeRingBuffer with the same interface.
+// Head and tail live on separate cache lines and are only ever stored by their owner, so there is no CAS.
+// Each side keeps a cached copy of the other side's index and reloads it only when the buffer looks full/empty.
+template <typename T>
+class SpscRingBuffer {
+public:
+    // One slot is kept empty to distinguish full from empty.
+    explicit SpscRingBuffer(size_t size) : buffer(std::make_unique<Slot[]>(size + 1)), slot_cnt(size + 1) {
+    }
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+    ~SpscRingBuffer() {
+        const size_t curr_tail = tail.load(std::memory_order_relaxed);
+        for (size_t idx = head.load(std::memory_order_relaxed); idx != curr_tail; idx = next(idx)) {
+            std::destroy_at(buffer[idx].ptr());
+        }
+    }
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        const size_t curr_tail = tail.load(std::memory_order_relaxed);
+        const size_t next_tail = next(curr_tail);
+        if (next_tail == cached_head) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (next_tail == cached_head) {
+                return false;
+            }
+        }
+        buffer[curr_tail].construct(std::forward<Args>(args)...);
+        tail.store(next_tail, std::memory_order_release);
+        return true;
+    }
+    bool enqueue(const T& val) {
+        return emplace(val);
+    }
+    bool enqueue(T&& val) {
+        return emplace(std::move(val));
+    }
+    bool try_dequeue(T& val) {
+        const size_t curr_head = head.load(std::memory_order_relaxed);
+        if (!readable(curr_head)) {
+            return false;
+        }
+        T* elem = buffer[curr_head].ptr();
+        val = std::move(*elem);
+        std::destroy_at(elem);
+        head.store(next(curr_head), std::memory_order_release);
+        return true;
+    }
+    std::optional<T> dequeue() {
+        const size_t curr_head = head.load(std::memory_order_relaxed);
+        if (!readable(curr_head)) {
+            return std::nullopt;
+        }
+        T* elem = buffer[curr_head].ptr();
+        std::optional<T> res(std::move(*elem));
+        std::destroy_at(elem);
+        head.store(next(curr_head), std::memory_order_release);
+        return res;
+    }
+private:
+    using Slot = RingSlot<T>;
+    size_t next(size_t idx) const {
+        return idx + 1 == slot_cnt ? 0 : idx + 1;
+    }
+    bool readable(size_t curr_head) {
+        if (curr_head == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (curr_head == cached_tail) {
+                return false;
+            }
+        }
+        return true;
+    }
+    const std::unique_ptr<Slot[]> buffer;
+    const size_t slot_cnt;
+    // Producer side.
+    alignas(kCacheLineSize) std::atomic<size_t> tail{0};
+    size_t cached_head = 0;
+    // Consumer side.
+    alignas(kCacheLineSize) std::atomic<size_t> head{0};
+    size_t cached_tail = 0;
+};
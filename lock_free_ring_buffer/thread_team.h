@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cpu_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Persistent pinned threads for the benchmarks, so that iterations measure the buffers and not thread
+// creation. run(f) calls f(thread_index) on every thread, released together through a barrier, and returns
+// once all of them are done.
+class ThreadTeam {
+public:
+    ThreadTeam(size_t thread_cnt, const std::vector<int>& cpus) : thread_cnt(thread_cnt), start_sync(thread_cnt) {
+        for (size_t i = 0; i < thread_cnt; ++i) {
+            threads.emplace_back([this, i, cpu = cpus[i]]() {
+                const ScopedPin pin(cpu);
+                work(i);
+            });
+        }
+    }
+    ThreadTeam(const ThreadTeam&) = delete;
+    ThreadTeam& operator=(const ThreadTeam&) = delete;
+    ~ThreadTeam() {
+        stopping = true;
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    size_t size() const {
+        return thread_cnt;
+    }
+    void run(std::function<void(size_t)> f) {
+        job = std::move(f);
+        done_cnt.store(0, std::memory_order_relaxed);
+        generation.fetch_add(1, std::memory_order_release);
+        generation.notify_all();
+        for (size_t done; (done = done_cnt.load(std::memory_order_acquire)) != thread_cnt; ) {
+            done_cnt.wait(done, std::memory_order_acquire);
+        }
+    }
+
+private:
+    void work(size_t idx) {
+        for (uint64_t seen = 0; ; ) {
+            generation.wait(seen, std::memory_order_acquire);
+            seen = generation.load(std::memory_order_acquire);
+            if (stopping) {
+                return;
+            }
+            start_sync.arrive_and_wait();
+            job(idx);
+            if (done_cnt.fetch_add(1, std::memory_order_release) + 1 == thread_cnt) {
+                done_cnt.notify_one();
+            }
+        }
+    }
+
+    const size_t thread_cnt;
+    std::function<void(size_t)> job;
+    std::barrier<> start_sync;
+    std::atomic<uint64_t> generation = 0;
+    std::atomic<size_t> done_cnt = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+};
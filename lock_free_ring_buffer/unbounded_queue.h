@@ -0,0 +1,291 @@
+#pragma once
+
+#include "ring_storage.h"
+#include "wait_strategy.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+// Unbounded multi-producer multi-consumer queue built from a linked list of fixed-size segments, in the style
+// of FAAArrayQueue / LCRQ. Producers and consumers claim slots of the current segment with a fetch_add on its
+// own enqueue/dequeue index; when the tail segment runs out of slots a producer links a new one, so enqueue
+// never fails. Every slot goes empty -> full -> taken or, if a consumer claims it before the producer has
+// written it, empty -> taken, in which case the producer takes its value back and retries at a later slot.
+// Segments the consumers have moved past are retired through epoch-based reclamation and then recycled
+// through a pool, so in a steady state the queue does not allocate.
+// The interface matches MpmcRingBuffer; enqueue always succeeds.
+// At most kRecordCnt (128) threads can be inside enqueue/dequeue at the same time: each operation holds one
+// reclamation record, and a thread beyond that spins until another thread's operation returns its record.
+template <typename T, size_t SegmentSize = 1024>
+class UnboundedQueue {
+public:
+    UnboundedQueue() : head(new Segment), tail(head.load(std::memory_order_relaxed)) {
+    }
+    UnboundedQueue(const UnboundedQueue&) = delete;
+    UnboundedQueue& operator=(const UnboundedQueue&) = delete;
+    ~UnboundedQueue() {
+        for (Segment* seg = head.load(std::memory_order_relaxed); seg != nullptr; ) {
+            for (auto& slot : seg->slots) {
+                if (slot.state.load(std::memory_order_relaxed) == kFull) {
+                    std::destroy_at(slot.value.ptr());
+                }
+            }
+            delete std::exchange(seg, seg->next.load(std::memory_order_relaxed));
+        }
+        for (auto& record : records) {
+            for (Segment* limbo : record.limbo) {
+                delete_list(limbo);
+            }
+        }
+        delete_list(pool.load(std::memory_order_relaxed));
+    }
+
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        return enqueue(T(std::forward<Args>(args)...));
+    }
+    bool enqueue(const T& val) {
+        return enqueue(T(val));
+    }
+    bool enqueue(T&& val) {
+        const Guard guard(*this);
+        while (true) {
+            Segment* seg = tail.load(std::memory_order_acquire);
+            const size_t idx = seg->enqueue_idx.fetch_add(1, std::memory_order_relaxed);
+            if (idx < SegmentSize) {
+                Slot& slot = seg->slots[idx];
+                slot.value.construct(std::move(val));
+                uint8_t expected = kEmpty;
+                if (slot.state.compare_exchange_strong(expected, kFull, std::memory_order_release, std::memory_order_relaxed)) {
+                    return true;
+                }
+                // A consumer gave up on this slot before we wrote it.
+                val = std::move(*slot.value.ptr());
+                std::destroy_at(slot.value.ptr());
+                continue;
+            }
+            if (seg != tail.load(std::memory_order_acquire)) {
+                continue;
+            }
+            Segment* next = seg->next.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                tail.compare_exchange_strong(seg, next, std::memory_order_release, std::memory_order_relaxed);
+                continue;
+            }
+            // The tail segment is full: link a new one that already holds our value in its first slot.
+            Segment* fresh = acquire_segment();
+            fresh->enqueue_idx.store(1, std::memory_order_relaxed);
+            fresh->slots[0].value.construct(std::move(val));
+            fresh->slots[0].state.store(kFull, std::memory_order_relaxed);
+            if (seg->next.compare_exchange_strong(next, fresh, std::memory_order_release, std::memory_order_acquire)) {
+                tail.compare_exchange_strong(seg, fresh, std::memory_order_release, std::memory_order_relaxed);
+                return true;
+            }
+            // Another producer linked its segment first; ours was never visible, so it goes straight back.
+            val = std::move(*fresh->slots[0].value.ptr());
+            std::destroy_at(fresh->slots[0].value.ptr());
+            push_to_pool(fresh, fresh);
+        }
+    }
+    bool try_dequeue(T& val) {
+        const Guard guard(*this);
+        Slot* slot = claim_full_slot(guard);
+        if (slot == nullptr) {
+            return false;
+        }
+        val = std::move(*slot->value.ptr());
+        std::destroy_at(slot->value.ptr());
+        return true;
+    }
+    std::optional<T> dequeue() {
+        const Guard guard(*this);
+        Slot* slot = claim_full_slot(guard);
+        if (slot == nullptr) {
+            return std::nullopt;
+        }
+        std::optional<T> res(std::move(*slot->value.ptr()));
+        std::destroy_at(slot->value.ptr());
+        return res;
+    }
+
+private:
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kFull = 1;
+    static constexpr uint8_t kTaken = 2;
+
+    struct Slot {
+        std::atomic<uint8_t> state{kEmpty};
+        RingSlot<T> value;
+    };
+    struct Segment {
+        alignas(kCacheLineSize) std::atomic<size_t> enqueue_idx{0};
+        alignas(kCacheLineSize) std::atomic<size_t> dequeue_idx{0};
+        alignas(kCacheLineSize) std::atomic<Segment*> next{nullptr};
+        // Links the segment into the pool or a limbo list once it is out of the queue.
+        Segment* next_free = nullptr;
+        std::array<Slot, SegmentSize> slots;
+    };
+
+    // Epoch-based reclamation: every operation runs inside a Guard that claims a record and publishes the
+    // global epoch it observed. The global epoch only advances when all active records have observed it, so a
+    // segment retired while the global epoch was e can no longer be referenced once the global epoch reaches e + 2.
+    static constexpr size_t kRecordCnt = 128;
+    static constexpr size_t kLimboCnt = 3;
+
+    struct alignas(kCacheLineSize) Record {
+        std::atomic<bool> active{false};
+        std::atomic<uint64_t> epoch{0};
+        // Segments retired by the record's holders, bucketed by the epoch they were retired in.
+        std::array<Segment*, kLimboCnt> limbo{};
+        std::array<uint64_t, kLimboCnt> limbo_epoch{};
+    };
+
+    class Guard {
+    public:
+        explicit Guard(UnboundedQueue& queue) : record(queue.claim_record()) {
+            uint64_t epoch = queue.global_epoch.load(std::memory_order_relaxed);
+            while (true) {
+                record.epoch.store(epoch, std::memory_order_seq_cst);
+                // Re-check: the epoch may have advanced before our store became visible to the advancing thread.
+                const uint64_t current = queue.global_epoch.load(std::memory_order_seq_cst);
+                if (current == epoch) {
+                    break;
+                }
+                epoch = current;
+            }
+            queue.collect(record, epoch);
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard() {
+            record.active.store(false, std::memory_order_release);
+        }
+        Record& record;
+    };
+
+    Record& claim_record() {
+        // Threads usually get the record they had last time, so the claim is an uncontended CAS. With every
+        // record held this keeps scanning until one is released, see the limit in the class comment.
+        static thread_local size_t hint = 0;
+        for (size_t i = hint; ; i = (i + 1) % kRecordCnt) {
+            bool expected = false;
+            if (!records[i].active.load(std::memory_order_relaxed) &&
+                records[i].active.compare_exchange_strong(expected, true, std::memory_order_seq_cst)) {
+                hint = i;
+                return records[i];
+            }
+            cpu_relax();
+        }
+    }
+    // Given a global epoch observed by the caller, moves segments retired at least two epochs earlier from the
+    // record's limbo lists to the pool.
+    void collect(Record& record, uint64_t epoch) {
+        for (size_t i = 0; i < kLimboCnt; ++i) {
+            if (record.limbo[i] != nullptr && record.limbo_epoch[i] + 2 <= epoch) {
+                Segment* last = record.limbo[i];
+                while (last->next_free != nullptr) {
+                    last = last->next_free;
+                }
+                push_to_pool(record.limbo[i], last);
+                record.limbo[i] = nullptr;
+            }
+        }
+    }
+    void retire(const Guard& guard, Segment* seg) {
+        Record& record = guard.record;
+        // Tag with the global epoch rather than the one we are pinned at: a thread that pinned after the global
+        // epoch advanced may still have read the segment before we unlinked it.
+        const uint64_t epoch = global_epoch.load(std::memory_order_seq_cst);
+        // Also empties the bucket we are about to reuse, it can only hold segments from epoch - 3 or earlier.
+        collect(record, epoch);
+        const size_t bucket = epoch % kLimboCnt;
+        record.limbo_epoch[bucket] = epoch;
+        seg->next_free = record.limbo[bucket];
+        record.limbo[bucket] = seg;
+        try_advance(epoch);
+    }
+    void try_advance(uint64_t epoch) {
+        for (const auto& record : records) {
+            if (record.active.load(std::memory_order_seq_cst) && record.epoch.load(std::memory_order_seq_cst) != epoch) {
+                return;
+            }
+        }
+        global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+    }
+
+    // The pool is a lock-free stack that only supports pushing a chain and taking everything at once,
+    // which unlike a single-element pop is not exposed to ABA.
+    void push_to_pool(Segment* first, Segment* last) {
+        Segment* top = pool.load(std::memory_order_relaxed);
+        do {
+            last->next_free = top;
+        } while (!pool.compare_exchange_weak(top, first, std::memory_order_release, std::memory_order_relaxed));
+    }
+    Segment* acquire_segment() {
+        Segment* seg = pool.exchange(nullptr, std::memory_order_acquire);
+        if (seg == nullptr) {
+            return new Segment;
+        }
+        if (Segment* rest = seg->next_free) {
+            Segment* last = rest;
+            while (last->next_free != nullptr) {
+                last = last->next_free;
+            }
+            push_to_pool(rest, last);
+        }
+        seg->enqueue_idx.store(0, std::memory_order_relaxed);
+        seg->dequeue_idx.store(0, std::memory_order_relaxed);
+        seg->next.store(nullptr, std::memory_order_relaxed);
+        seg->next_free = nullptr;
+        for (auto& slot : seg->slots) {
+            slot.state.store(kEmpty, std::memory_order_relaxed);
+        }
+        return seg;
+    }
+    static void delete_list(Segment* seg) {
+        while (seg != nullptr) {
+            delete std::exchange(seg, seg->next_free);
+        }
+    }
+
+    // Claims the oldest slot that holds a value, or returns nullptr if the queue is empty.
+    Slot* claim_full_slot(const Guard& guard) {
+        while (true) {
+            Segment* seg = head.load(std::memory_order_acquire);
+            if (seg->dequeue_idx.load(std::memory_order_relaxed) >= seg->enqueue_idx.load(std::memory_order_relaxed) &&
+                seg->next.load(std::memory_order_acquire) == nullptr) {
+                return nullptr;
+            }
+            const size_t idx = seg->dequeue_idx.fetch_add(1, std::memory_order_relaxed);
+            if (idx < SegmentSize) {
+                Slot& slot = seg->slots[idx];
+                if (slot.state.exchange(kTaken, std::memory_order_acquire) == kFull) {
+                    return &slot;
+                }
+                // The producer of this slot has not written it yet, it will retry elsewhere.
+                continue;
+            }
+            Segment* next = seg->next.load(std::memory_order_acquire);
+            if (next == nullptr) {
+                return nullptr;
+            }
+            // Keep tail ahead of head so that a retired segment is never reachable from the queue.
+            Segment* expected = seg;
+            tail.compare_exchange_strong(expected, next, std::memory_order_release, std::memory_order_relaxed);
+            if (head.compare_exchange_strong(seg, next, std::memory_order_release, std::memory_order_relaxed)) {
+                retire(guard, seg);
+            }
+        }
+    }
+
+    alignas(kCacheLineSize) std::atomic<Segment*> head;
+    alignas(kCacheLineSize) std::atomic<Segment*> tail;
+    alignas(kCacheLineSize) std::atomic<Segment*> pool{nullptr};
+    alignas(kCacheLineSize) std::atomic<uint64_t> global_epoch{0};
+    std::array<Record, kRecordCnt> records;
+};
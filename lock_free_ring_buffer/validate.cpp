@@ -1,21 +1,67 @@
+#include "async_ring_buffer.h"
+#include "blocking_ring_buffer.h"
+#include "broadcast_ring_buffer.h"
+#include "byte_ring_buffer.h"
 #include "lock_free_ring_buffer.h"
+#include "mpmc_ring_buffer.h"
+#include "spsc_ring_buffer.h"
+#include "unbounded_queue.h"
+#ifdef __linux__
+#include "shm_region.h"
+#include "shm_ring_buffer.h"
+#endif
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <barrier>
+#include <cstring>
+#include <functional>
 #include <future>
 #include <iostream>
+#include <latch>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
-int main() {
-    constexpr size_t kSize = 111;
-    constexpr size_t kElemCnt = 1234;
-    constexpr size_t kTestCnt = 1000;
-    LockFreeRingBuffer ring_buffer(kSize);
-    for (int t = 0; t < kTestCnt; ++t) {
+namespace {
+
+constexpr size_t kSize = 111;
+constexpr size_t kElemCnt = 1234;
+
+// Fixed-capacity buffers are default-constructed, the rest take the requested size.
+template <typename Buffer>
+std::unique_ptr<Buffer> make_ring_buffer(size_t size) {
+    if constexpr (std::is_constructible_v<Buffer, size_t>) {
+        return std::make_unique<Buffer>(size);
+    } else {
+        return std::make_unique<Buffer>();
+    }
+}
+
+struct Message {
+    Message() = default;
+    Message(int seq, char fill) : seq(seq) {
+        payload.fill(fill);
+    }
+    int seq = -1;
+    std::array<char, 124> payload{};
+};
+
+// One producer pushes kElemCnt elements through the buffer, one consumer checks that they come out in order.
+// `produce(ring_buffer, i)` tries to enqueue the i-th element, `consume(ring_buffer)` tries to dequeue one
+// and returns its index or -1 when the buffer is empty.
+template <typename Buffer, typename Produce, typename Consume>
+bool validate_fifo(const char* name, size_t test_cnt, Buffer& ring_buffer, Produce produce, Consume consume) {
+    for (int t = 0; t < test_cnt; ++t) {
         std::vector<std::future<void>> futures;
         std::barrier sync(2);
         futures.push_back(std::async(std::launch::async, [&]() {
             sync.arrive_and_wait();
             for (int i = 0; i < kElemCnt; ++i) {
-                while (!ring_buffer.enqueue(i)) {
+                while (!produce(ring_buffer, i)) {
                 }
             }
         }));
@@ -23,11 +69,56 @@ int main() {
         futures.push_back(std::async(std::launch::async, [&]() {
             sync.arrive_and_wait();
             for (int i = 0; i < kElemCnt; ++i) {
-                std::optional<int> val;
+                int val;
                 do {
-                    val = ring_buffer.dequeue();
-                } while (!val.has_value());
-                dequeued[i] = *val;
+                    val = consume(ring_buffer);
+                } while (val == -1);
+                dequeued[i] = val;
+            }
+        }));
+        for (auto& future : futures) {
+            future.get();
+        }
+        for (int i = 0; i < kElemCnt; ++i) {
+            if (dequeued[i] != i) {
+                std::cerr << "Error (" << name << "): dequeued[" << i << "] = " << dequeued[i] << ", expected " << i << ", round " << t << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename Buffer, typename Produce, typename Consume>
+bool validate_fifo(const char* name, size_t test_cnt, Produce produce, Consume consume) {
+    const auto ring_buffer = make_ring_buffer<Buffer>(kSize);
+    return validate_fifo(name, test_cnt, *ring_buffer, produce, consume);
+}
+
+// Same as validate_fifo but both sides move whole batches of varying size with the bulk API.
+bool validate_bulk(size_t test_cnt) {
+    constexpr size_t kMaxBatch = 150;
+    std::vector<int> vals(kElemCnt);
+    for (int i = 0; i < kElemCnt; ++i) {
+        vals[i] = i;
+    }
+    LockFreeRingBuffer<int> ring_buffer(kSize);
+    for (int t = 0; t < test_cnt; ++t) {
+        std::vector<std::future<void>> futures;
+        std::barrier sync(2);
+        futures.push_back(std::async(std::launch::async, [&]() {
+            sync.arrive_and_wait();
+            for (size_t i = 0, batch = 1; i < kElemCnt; batch = batch % kMaxBatch + 1) {
+                const auto cnt = std::min(batch, kElemCnt - i);
+                i += ring_buffer.enqueue_bulk(std::span<const int>(vals).subspan(i, cnt));
+            }
+        }));
+        std::vector<int> dequeued(kElemCnt);
+        futures.push_back(std::async(std::launch::async, [&]() {
+            sync.arrive_and_wait();
+            for (size_t i = 0, batch = kMaxBatch; i < kElemCnt; batch = batch % kMaxBatch + 1) {
+                const auto cnt = std::min(batch, kElemCnt - i);
+                i += ring_buffer.dequeue_bulk(std::span<int>(dequeued).subspan(i, cnt));
             }
         }));
         for (auto& future : futures) {
@@ -35,10 +126,475 @@ int main() {
         }
         for (int i = 0; i < kElemCnt; ++i) {
             if (dequeued[i] != i) {
-                std::cerr << "Error: dequeued[" << i << "] = " << dequeued[i] << ", expected " << i << ", round " << t << "\n";
-                return EXIT_FAILURE;
+                std::cerr << "Error (bulk): dequeued[" << i << "] = " << dequeued[i] << ", expected " << i << ", round " << t << "\n";
+                return false;
             }
         }
     }
-    return EXIT_SUCCESS;
+    return true;
+}
+
+// Checks that every one of the producer_cnt * kElemCnt values was dequeued exactly once and that each consumer
+// saw each producer's values in order.
+bool check_dequeued(const char* name, const std::vector<std::vector<int>>& dequeued, size_t producer_cnt, int round) {
+    const size_t total_cnt = producer_cnt * kElemCnt;
+    std::vector<int> seen(total_cnt);
+    for (size_t c = 0; c < dequeued.size(); ++c) {
+        std::vector<int> last(producer_cnt, -1);
+        for (const int val : dequeued[c]) {
+            if (val < 0 || val >= total_cnt) {
+                std::cerr << "Error (" << name << "): consumer " << c << " dequeued unknown value " << val << ", round " << round << "\n";
+                return false;
+            }
+            const auto producer = val / kElemCnt;
+            if (val <= last[producer]) {
+                std::cerr << "Error (" << name << "): consumer " << c << " dequeued " << val << " after " << last[producer] << ", round " << round << "\n";
+                return false;
+            }
+            last[producer] = val;
+            ++seen[val];
+        }
+    }
+    const auto bad = std::find_if(seen.begin(), seen.end(), [](int cnt) { return cnt != 1; });
+    if (bad != seen.end()) {
+        std::cerr << "Error (" << name << "): value " << bad - seen.begin() << " dequeued " << *bad << " times, round " << round << "\n";
+        return false;
+    }
+    return true;
+}
+
+// producer_cnt producers each push kElemCnt tagged values, consumer_cnt consumers drain the buffer.
+template <typename Buffer>
+bool validate_mpmc(const char* name, size_t producer_cnt, size_t consumer_cnt, size_t test_cnt) {
+    const size_t total_cnt = producer_cnt * kElemCnt;
+    const auto ring_buffer_ptr = make_ring_buffer<Buffer>(kSize);
+    auto& ring_buffer = *ring_buffer_ptr;
+    for (int t = 0; t < test_cnt; ++t) {
+        std::vector<std::future<void>> futures;
+        std::barrier sync(producer_cnt + consumer_cnt);
+        for (size_t p = 0; p < producer_cnt; ++p) {
+            futures.push_back(std::async(std::launch::async, [&, p]() {
+                sync.arrive_and_wait();
+                for (int i = 0; i < kElemCnt; ++i) {
+                    while (!ring_buffer.enqueue(p * kElemCnt + i)) {
+                    }
+                }
+            }));
+        }
+        std::atomic<size_t> dequeued_cnt = 0;
+        std::vector<std::vector<int>> dequeued(consumer_cnt);
+        for (size_t c = 0; c < consumer_cnt; ++c) {
+            futures.push_back(std::async(std::launch::async, [&, c]() {
+                sync.arrive_and_wait();
+                int val;
+                while (dequeued_cnt.load() < total_cnt) {
+                    if (ring_buffer.try_dequeue(val)) {
+                        dequeued[c].push_back(val);
+                        dequeued_cnt.fetch_add(1);
+                    }
+                }
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+        if (!check_dequeued(name, dequeued, producer_cnt, t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Requested sizes 0 and 1 still give two slots: a full single slot would look free to the next producer and be
+// overwritten. Checks the capacity sequentially, then pushes kElemCnt elements through it on two threads.
+bool validate_tiny_mpmc(size_t test_cnt) {
+    for (const size_t size : {0, 1}) {
+        MpmcRingBuffer<int> ring_buffer(size);
+        int val = -1;
+        if (!ring_buffer.enqueue(1) || !ring_buffer.enqueue(2) || ring_buffer.enqueue(3) ||
+            !ring_buffer.try_dequeue(val) || val != 1 || !ring_buffer.try_dequeue(val) || val != 2 ||
+            ring_buffer.try_dequeue(val)) {
+            std::cerr << "Error (MpmcRingBuffer of size " << size << "): wrong capacity or order\n";
+            return false;
+        }
+        const bool ok = validate_fifo(size == 0 ? "MpmcRingBuffer of size 0" : "MpmcRingBuffer of size 1", test_cnt, ring_buffer,
+            [](MpmcRingBuffer<int>& ring_buffer, int i) {
+                return ring_buffer.enqueue(i);
+            },
+            [](MpmcRingBuffer<int>& ring_buffer) {
+                int val;
+                return ring_buffer.try_dequeue(val) ? val : -1;
+            }
+        );
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same as validate_mpmc through the blocking push/pop calls, consumer_cnt must divide the total element count.
+template <typename WaitStrategy>
+bool validate_blocking(const char* name, size_t producer_cnt, size_t consumer_cnt, size_t test_cnt) {
+    const size_t total_cnt = producer_cnt * kElemCnt;
+    BlockingRingBuffer<int, WaitStrategy> ring_buffer(kSize);
+    for (int t = 0; t < test_cnt; ++t) {
+        std::vector<std::future<void>> futures;
+        for (size_t p = 0; p < producer_cnt; ++p) {
+            futures.push_back(std::async(std::launch::async, [&, p]() {
+                for (int i = 0; i < kElemCnt; ++i) {
+                    ring_buffer.push(p * kElemCnt + i);
+                }
+            }));
+        }
+        std::vector<std::vector<int>> dequeued(consumer_cnt);
+        for (size_t c = 0; c < consumer_cnt; ++c) {
+            futures.push_back(std::async(std::launch::async, [&, c]() {
+                for (size_t i = 0; i < total_cnt / consumer_cnt; ++i) {
+                    dequeued[c].push_back(ring_buffer.pop());
+                }
+            }));
+        }
+        for (auto& future : futures) {
+            future.get();
+        }
+        if (!check_dequeued(name, dequeued, producer_cnt, t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Aliases pin the capacity so that the buffers match the one-parameter template template argument below.
+template <typename T>
+using DynamicRingBuffer = LockFreeRingBuffer<T>;
+
+template <typename T>
+using FixedRingBuffer = LockFreeRingBuffer<T, kSize>;
+
+template <typename T>
+using FixedPow2RingBuffer = LockFreeRingBuffer<T, 128>;
+
+// Small segments so that the tests go through segment linking, retirement and recycling many times.
+template <typename T>
+using SmallSegmentQueue = UnboundedQueue<T, 32>;
+
+template <template <typename> typename Buffer>
+bool validate_buffer(const char* name, size_t test_cnt) {
+    std::cout << "Validating " << name << "\n";
+    const bool ok_int = validate_fifo<Buffer<int>>("int", test_cnt,
+        [](auto& ring_buffer, int i) {
+            return ring_buffer.enqueue(i);
+        },
+        [](auto& ring_buffer) {
+            const std::optional<int> val = ring_buffer.dequeue();
+            return val.has_value() ? *val : -1;
+        }
+    );
+    const bool ok_unique_ptr = validate_fifo<Buffer<std::unique_ptr<int>>>("unique_ptr", test_cnt / 10,
+        [](auto& ring_buffer, int i) {
+            return ring_buffer.enqueue(std::make_unique<int>(i));
+        },
+        [](auto& ring_buffer) {
+            std::unique_ptr<int> val;
+            return ring_buffer.try_dequeue(val) ? *val : -1;
+        }
+    );
+    const bool ok_message = validate_fifo<Buffer<Message>>("message", test_cnt / 10,
+        [](auto& ring_buffer, int i) {
+            return ring_buffer.emplace(i, static_cast<char>(i));
+        },
+        [](auto& ring_buffer) {
+            Message val;
+            if (!ring_buffer.try_dequeue(val)) {
+                return -1;
+            }
+            for (const char c : val.payload) {
+                if (c != static_cast<char>(val.seq)) {
+                    return -2;
+                }
+            }
+            return val.seq;
+        }
+    );
+    return ok_int && ok_unique_ptr && ok_message;
+}
+
+// Producer serializes straight into the claimed slot, consumer checks the record in place.
+bool validate_zero_copy(size_t test_cnt) {
+    return validate_fifo<LockFreeRingBuffer<Message>>("zero-copy", test_cnt,
+        [](auto& ring_buffer, int i) {
+            Message* msg = ring_buffer.try_claim();
+            if (msg == nullptr) {
+                return false;
+            }
+            msg->seq = i;
+            msg->payload.fill(static_cast<char>(i));
+            ring_buffer.commit();
+            return true;
+        },
+        [](auto& ring_buffer) {
+            const Message* msg = ring_buffer.peek();
+            if (msg == nullptr) {
+                return -1;
+            }
+            int seq = msg->seq;
+            for (const char c : msg->payload) {
+                if (c != static_cast<char>(msg->seq)) {
+                    seq = -2;
+                }
+            }
+            ring_buffer.release();
+            return seq;
+        }
+    );
+}
+
+// Records of 4..403 bytes, so they regularly hit the end of the buffer and wrap behind a padding marker.
+// Every third record is claimed larger than needed and shrunk on commit.
+bool validate_byte_ring(size_t test_cnt) {
+    constexpr size_t kCapacity = 1024;
+    const auto record_size = [](int i) {
+        return sizeof(int) + static_cast<size_t>(i) * 7 % 400;
+    };
+    ByteRingBuffer ring_buffer(kCapacity);
+    try {
+        ring_buffer.claim(kCapacity);
+        std::cerr << "Error (ByteRingBuffer): claim larger than the buffer succeeded\n";
+        return false;
+    } catch (const std::length_error&) {
+    }
+    return validate_fifo("ByteRingBuffer", test_cnt, ring_buffer,
+        [&](ByteRingBuffer& ring_buffer, int i) {
+            const size_t size = record_size(i);
+            const auto payload = ring_buffer.claim(i % 3 == 0 ? size + 64 : size);
+            if (!payload) {
+                return false;
+            }
+            std::memcpy(payload->data(), &i, sizeof(i));
+            std::memset(payload->data() + sizeof(i), i, size - sizeof(i));
+            ring_buffer.commit(size);
+            return true;
+        },
+        [&](ByteRingBuffer& ring_buffer) {
+            const auto payload = ring_buffer.peek();
+            if (!payload) {
+                return -1;
+            }
+            int seq;
+            std::memcpy(&seq, payload->data(), sizeof(seq));
+            if (payload->size() != record_size(seq)) {
+                seq = -2;
+            }
+            for (const std::byte b : payload->subspan(sizeof(seq))) {
+                if (b != static_cast<std::byte>(seq)) {
+                    seq = -2;
+                }
+            }
+            ring_buffer.release();
+            return seq;
+        }
+    );
+}
+
+// A journal and a logger read independently, the strategy depends on the journal. Every consumer has to see
+// every message in order, and the strategy must never get ahead of the journal.
+bool validate_broadcast(size_t test_cnt) {
+    for (int t = 0; t < test_cnt; ++t) {
+        BroadcastRingBuffer<Message> ring_buffer(kSize);
+        auto& journal = ring_buffer.add_consumer();
+        auto& logger = ring_buffer.add_consumer();
+        auto& strategy = ring_buffer.add_consumer({&journal});
+        std::atomic<int> journaled = 0;
+        std::barrier sync(4);
+        std::vector<std::future<bool>> futures;
+        futures.push_back(std::async(std::launch::async, [&]() {
+            sync.arrive_and_wait();
+            for (int i = 0; i < kElemCnt; ++i) {
+                while (!ring_buffer.emplace(i, static_cast<char>(i))) {
+                }
+            }
+            return true;
+        }));
+        const auto consume = [&](const char* name, BroadcastRingBuffer<Message>::Consumer& consumer, bool is_journal, bool after_journal) {
+            sync.arrive_and_wait();
+            for (int i = 0; i < kElemCnt; ++i) {
+                const Message* msg;
+                while ((msg = consumer.peek()) == nullptr) {
+                }
+                const bool payload_ok = std::all_of(msg->payload.begin(), msg->payload.end(), [&](char c) {
+                    return c == static_cast<char>(i);
+                });
+                if (msg->seq != i || !payload_ok || (after_journal && i >= journaled.load())) {
+                    std::cerr << "Error (broadcast): " << name << " read message " << msg->seq << " at position " << i << ", round " << t << "\n";
+                    return false;
+                }
+                // Mark the message as journaled before releasing it to the strategy.
+                if (is_journal) {
+                    journaled.store(i + 1);
+                }
+                consumer.release();
+            }
+            return true;
+        };
+        futures.push_back(std::async(std::launch::async, consume, "journal", std::ref(journal), true, false));
+        futures.push_back(std::async(std::launch::async, consume, "logger", std::ref(logger), false, false));
+        futures.push_back(std::async(std::launch::async, consume, "strategy", std::ref(strategy), false, true));
+        bool ok = true;
+        for (auto& future : futures) {
+            ok &= future.get();
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Task produce_async(AsyncRingBuffer<int>& ring_buffer, int first, int cnt, std::latch& done) {
+    for (int i = 0; i < cnt; ++i) {
+        co_await ring_buffer.push(first + i);
+    }
+    done.count_down();
+}
+
+Task consume_async(AsyncRingBuffer<int>& ring_buffer, int cnt, std::vector<int>& dequeued, std::latch& done) {
+    for (int i = 0; i < cnt; ++i) {
+        dequeued.push_back(co_await ring_buffer.pop());
+    }
+    done.count_down();
+}
+
+// On one thread with a tiny buffer every push and pop alternates between suspending and waking the other side.
+bool validate_async_single_threaded(size_t test_cnt) {
+    for (int t = 0; t < test_cnt; ++t) {
+        SingleThreadedExecutor executor;
+        AsyncRingBuffer<int> ring_buffer(4, executor);
+        std::latch done(2);
+        std::vector<std::vector<int>> dequeued(1);
+        // The consumer starts first and suspends on the empty buffer.
+        consume_async(ring_buffer, kElemCnt, dequeued[0], done).start(executor);
+        produce_async(ring_buffer, 0, kElemCnt, done).start(executor);
+        executor.run();
+        if (!done.try_wait()) {
+            std::cerr << "Error (async, single-threaded): coroutines did not finish, round " << t << "\n";
+            return false;
+        }
+        if (!check_dequeued("async, single-threaded", dequeued, 1, t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Same as validate_mpmc with producer and consumer coroutines on a thread pool; consumer_cnt must divide the
+// total element count.
+bool validate_async_thread_pool(size_t producer_cnt, size_t consumer_cnt, size_t test_cnt) {
+    const size_t total_cnt = producer_cnt * kElemCnt;
+    ThreadPoolExecutor executor(4);
+    AsyncRingBuffer<int> ring_buffer(kSize, executor);
+    for (int t = 0; t < test_cnt; ++t) {
+        std::latch done(producer_cnt + consumer_cnt);
+        std::vector<std::vector<int>> dequeued(consumer_cnt);
+        for (size_t c = 0; c < consumer_cnt; ++c) {
+            consume_async(ring_buffer, total_cnt / consumer_cnt, dequeued[c], done).start(executor);
+        }
+        for (size_t p = 0; p < producer_cnt; ++p) {
+            produce_async(ring_buffer, p * kElemCnt, kElemCnt, done).start(executor);
+        }
+        done.wait();
+        if (!check_dequeued("async, thread pool", dequeued, producer_cnt, t)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#ifdef __linux__
+// The producer and the consumer use two separate mappings of one memfd region, as two processes would.
+// Also checks that attaching with a mismatching payload type is rejected.
+bool validate_shm(size_t test_cnt) {
+    struct ShmViews {
+        ShmRingBuffer<Message> producer;
+        ShmRingBuffer<Message> consumer;
+    };
+    const auto region_bytes = ShmRingBuffer<Message>::region_size(kSize);
+    const auto region = SharedMemoryRegion::create_memfd("validate_shm", region_bytes);
+    const auto mirror = SharedMemoryRegion::attach_fd(dup(region.fd()));
+    ShmViews views{
+        ShmRingBuffer<Message>::create(region.data(), region.size(), kSize),
+        ShmRingBuffer<Message>::attach(mirror.data(), mirror.size())
+    };
+    try {
+        ShmRingBuffer<int>::attach(mirror.data(), mirror.size());
+        std::cerr << "Error (shm): attach with a different payload type succeeded\n";
+        return false;
+    } catch (const std::runtime_error&) {
+    }
+    return validate_fifo("shm", test_cnt, views,
+        [](ShmViews& views, int i) {
+            return views.producer.enqueue(Message(i, static_cast<char>(i)));
+        },
+        [](ShmViews& views) {
+            Message val;
+            if (!views.consumer.try_dequeue(val)) {
+                return -1;
+            }
+            for (const char c : val.payload) {
+                if (c != static_cast<char>(val.seq)) {
+                    return -2;
+                }
+            }
+            return val.seq;
+        }
+    );
+}
+#endif
+
+} // namespace
+
+int main() {
+    constexpr size_t kTestCnt = 1000;
+    bool ok = true;
+    ok &= validate_buffer<DynamicRingBuffer>("LockFreeRingBuffer", kTestCnt);
+    ok &= validate_buffer<FixedRingBuffer>("LockFreeRingBuffer<T, 111>", kTestCnt);
+    ok &= validate_buffer<FixedPow2RingBuffer>("LockFreeRingBuffer<T, 128>", kTestCnt);
+    ok &= validate_buffer<SpscRingBuffer>("SpscRingBuffer", kTestCnt);
+    std::cout << "Validating LockFreeRingBuffer claim/commit and peek/release\n";
+    ok &= validate_zero_copy(kTestCnt / 10);
+    std::cout << "Validating LockFreeRingBuffer bulk API\n";
+    ok &= validate_bulk(kTestCnt);
+    std::cout << "Validating BroadcastRingBuffer\n";
+    ok &= validate_broadcast(kTestCnt / 10);
+    std::cout << "Validating ByteRingBuffer\n";
+    ok &= validate_byte_ring(kTestCnt / 10);
+#ifdef __linux__
+    std::cout << "Validating ShmRingBuffer\n";
+    ok &= validate_shm(kTestCnt / 10);
+#endif
+    ok &= validate_buffer<MpmcRingBuffer>("MpmcRingBuffer", kTestCnt);
+    for (const auto& [producer_cnt, consumer_cnt] : {std::pair{1, 4}, std::pair{4, 1}, std::pair{4, 4}}) {
+        std::cout << "Validating MpmcRingBuffer with " << producer_cnt << " producers and " << consumer_cnt << " consumers\n";
+        ok &= validate_mpmc<MpmcRingBuffer<int>>("MpmcRingBuffer", producer_cnt, consumer_cnt, kTestCnt / 10);
+    }
+    std::cout << "Validating MpmcRingBuffer of size 0 and 1\n";
+    ok &= validate_tiny_mpmc(kTestCnt / 10);
+    ok &= validate_buffer<SmallSegmentQueue>("UnboundedQueue", kTestCnt);
+    for (const auto& [producer_cnt, consumer_cnt] : {std::pair{1, 4}, std::pair{4, 1}, std::pair{4, 4}}) {
+        std::cout << "Validating UnboundedQueue with " << producer_cnt << " producers and " << consumer_cnt << " consumers\n";
+        ok &= validate_mpmc<UnboundedQueue<int, 32>>("UnboundedQueue", producer_cnt, consumer_cnt, kTestCnt / 10);
+    }
+    std::cout << "Validating AsyncRingBuffer on a single-threaded executor\n";
+    ok &= validate_async_single_threaded(kTestCnt / 10);
+    for (const auto& [producer_cnt, consumer_cnt] : {std::pair{1, 1}, std::pair{4, 2}, std::pair{2, 4}}) {
+        std::cout << "Validating AsyncRingBuffer with " << producer_cnt << " producers and " << consumer_cnt << " consumers\n";
+        ok &= validate_async_thread_pool(producer_cnt, consumer_cnt, kTestCnt / 10);
+    }
+    for (const auto& [producer_cnt, consumer_cnt] : {std::pair{1, 1}, std::pair{4, 2}, std::pair{2, 4}}) {
+        std::cout << "Validating BlockingRingBuffer with " << producer_cnt << " producers and " << consumer_cnt << " consumers\n";
+        ok &= validate_blocking<SpinWait>("SpinWait", producer_cnt, consumer_cnt, kTestCnt / 10);
+        ok &= validate_blocking<BackoffWait>("BackoffWait", producer_cnt, consumer_cnt, kTestCnt / 10);
+        ok &= validate_blocking<ParkWait>("ParkWait", producer_cnt, consumer_cnt, kTestCnt / 10);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "cpu_utils.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+// Wait strategies used by BlockingRingBuffer. wait_until(try_op) retries try_op until it returns true,
+// notify() is called by the other side after every operation that could make try_op succeed.
+
+// Busy-spins: lowest latency, but burns a whole core per waiting thread.
+class SpinWait {
+public:
+    template <typename TryOp>
+    void wait_until(TryOp try_op) {
+        while (!try_op()) {
+        }
+    }
+    void notify() {
+    }
+};
+
+// Spins with a pause instruction for a while, then yields the core between attempts.
+class BackoffWait {
+public:
+    template <typename TryOp>
+    void wait_until(TryOp try_op) {
+        for (int i = 0; !try_op(); ++i) {
+            if (i < kSpinCnt) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+    void notify() {
+    }
+private:
+    static constexpr int kSpinCnt = 128;
+};
+
+// Spins briefly, then parks the thread on a futex via std::atomic::wait. The notifier only pays for a fence
+// and a load of the waiter count unless somebody is actually parked.
+class ParkWait {
+public:
+    template <typename TryOp>
+    void wait_until(TryOp try_op) {
+        for (int i = 0; i < kSpinCnt; ++i) {
+            if (try_op()) {
+                return;
+            }
+            cpu_relax();
+        }
+        while (true) {
+            const uint32_t curr_epoch = epoch.load(std::memory_order_acquire);
+            waiters.fetch_add(1, std::memory_order_relaxed);
+            // Pairs with the fence in notify(): either the notifier sees us in `waiters`,
+            // or we see the state change it published in try_op().
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const bool done = try_op();
+            if (!done) {
+                epoch.wait(curr_epoch, std::memory_order_acquire);
+            }
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+            if (done) {
+                return;
+            }
+        }
+    }
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) != 0) {
+            epoch.fetch_add(1, std::memory_order_release);
+            epoch.notify_one();
+        }
+    }
+private:
+    static constexpr int kSpinCnt = 128;
+    std::atomic<uint32_t> epoch = 0;
+    std::atomic<uint32_t> waiters = 0;
+};
@@ -1,6 +1,8 @@
 #include "solution.h"
 #include "init.h"
 
+#include "perf_counters.h"
+
 #include <benchmark/benchmark.h>
 
 namespace {
@@ -10,21 +12,27 @@ constexpr size_t K = 602;
 constexpr size_t M = 703;
 
 void bench_ref(benchmark::State& state) {
+  PerfCounters perf;
   const auto [a, b] = init(N, K, M);
   const auto ref = reference_solution();
   ref->set_input(a, b, N, K, M);
+  perf.start();
   for (auto _ : state) {
     ref->run_kernel();
   }
+  perf.report(state);
 }
 
 void bench_sol(benchmark::State& state) {
+  PerfCounters perf;
   const auto [a, b] = init(N, K, M);
   const auto sol = solution();
   sol->set_input(a, b, N, K, M);
+  perf.start();
   for (auto _ : state) {
     sol->run_kernel();
   }
+  perf.report(state);
 }
 
 }  // namespace
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Memory orders used by the accesses of a litmus test: `Relaxed` everywhere, release stores with acquire loads,
+// or `SeqCst` everywhere. They are template parameters because a memory order that is not a constant is
+// treated as seq_cst by the compilers.
+enum class Order { Relaxed, AcqRel, SeqCst };
+
+// What separates the two accesses of a thread: nothing, a compiler-only barrier (atomic_signal_fence) or a
+// full hardware fence (atomic_thread_fence(seq_cst)).
+enum class Fence { None, Signal, Thread };
+
+inline const char* order_name(Order order) {
+    switch (order) {
+    case Order::Relaxed: return "relaxed";
+    case Order::AcqRel: return "acq_rel";
+    case Order::SeqCst: return "seq_cst";
+    }
+    return "";
+}
+
+inline const char* fence_name(Fence fence) {
+    switch (fence) {
+    case Fence::None: return "none";
+    case Fence::Signal: return "signal";
+    case Fence::Thread: return "thread";
+    }
+    return "";
+}
+
+template <Order O>
+constexpr std::memory_order kStoreOrder = O == Order::Relaxed ? std::memory_order_relaxed :
+                                          O == Order::AcqRel ? std::memory_order_release : std::memory_order_seq_cst;
+
+template <Order O>
+constexpr std::memory_order kLoadOrder = O == Order::Relaxed ? std::memory_order_relaxed :
+                                         O == Order::AcqRel ? std::memory_order_acquire : std::memory_order_seq_cst;
+
+template <Fence F>
+void prevent_reordering() {
+    if constexpr (F == Fence::Signal) {
+        std::atomic_signal_fence(std::memory_order_acq_rel);
+    } else if constexpr (F == Fence::Thread) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+// Every test has kThreadCnt threads that each call run<O, F>(thread) once per iteration after reset(), and
+// weak() tells whether the outcome of the iteration is the one that needs reordering. Results are plain
+// variables: the threads and the checker are synchronized between iterations.
+
+// Store buffering: each thread stores its flag and loads the other one. Both loads seeing 0 means a store was
+// delayed past the following load; only seq_cst accesses or a thread fence forbid it, and x86 shows it.
+struct StoreBuffering {
+    static constexpr const char* kName = "SB";
+    static constexpr size_t kThreadCnt = 2;
+
+    void reset() {
+        x.store(0, std::memory_order_relaxed);
+        y.store(0, std::memory_order_relaxed);
+    }
+    template <Order O, Fence F>
+    void run(size_t thread) {
+        if (thread == 0) {
+            x.store(1, kStoreOrder<O>);
+            prevent_reordering<F>();
+            r0 = y.load(kLoadOrder<O>);
+        } else {
+            y.store(1, kStoreOrder<O>);
+            prevent_reordering<F>();
+            r1 = x.load(kLoadOrder<O>);
+        }
+    }
+    bool weak() const {
+        return r0 == 0 && r1 == 0;
+    }
+
+    std::atomic<int> x, y;
+    int r0 = 0, r1 = 0;
+};
+
+// Message passing: data then flag on one side, flag then data on the other. Seeing the flag without the data
+// is forbidden from acq_rel on; with relaxed accesses only the compiler or a weakly ordered CPU reorders.
+struct MessagePassing {
+    static constexpr const char* kName = "MP";
+    static constexpr size_t kThreadCnt = 2;
+
+    void reset() {
+        data.store(0, std::memory_order_relaxed);
+        flag.store(0, std::memory_order_relaxed);
+    }
+    template <Order O, Fence F>
+    void run(size_t thread) {
+        if (thread == 0) {
+            data.store(1, kStoreOrder<O>);
+            prevent_reordering<F>();
+            flag.store(1, kStoreOrder<O>);
+        } else {
+            r0 = flag.load(kLoadOrder<O>);
+            prevent_reordering<F>();
+            r1 = data.load(kLoadOrder<O>);
+        }
+    }
+    bool weak() const {
+        return r0 == 1 && r1 == 0;
+    }
+
+    std::atomic<int> data, flag;
+    int r0 = 0, r1 = 0;
+};
+
+// Load buffering: each thread loads one variable and then stores the other. Both loads seeing the other
+// thread's store means a load was satisfied after the following store; allowed for relaxed accesses, never
+// seen on x86.
+struct LoadBuffering {
+    static constexpr const char* kName = "LB";
+    static constexpr size_t kThreadCnt = 2;
+
+    void reset() {
+        x.store(0, std::memory_order_relaxed);
+        y.store(0, std::memory_order_relaxed);
+    }
+    template <Order O, Fence F>
+    void run(size_t thread) {
+        if (thread == 0) {
+            r0 = x.load(kLoadOrder<O>);
+            prevent_reordering<F>();
+            y.store(1, kStoreOrder<O>);
+        } else {
+            r1 = y.load(kLoadOrder<O>);
+            prevent_reordering<F>();
+            x.store(1, kStoreOrder<O>);
+        }
+    }
+    bool weak() const {
+        return r0 == 1 && r1 == 1;
+    }
+
+    std::atomic<int> x, y;
+    int r0 = 0, r1 = 0;
+};
+
+// Independent reads of independent writes: two writers, two readers that read the variables in opposite
+// orders. The readers disagreeing on the order of the writes is only forbidden by seq_cst (or thread fences);
+// it needs a non-multi-copy-atomic machine such as POWER, x86 never shows it.
+struct Iriw {
+    static constexpr const char* kName = "IRIW";
+    static constexpr size_t kThreadCnt = 4;
+
+    void reset() {
+        x.store(0, std::memory_order_relaxed);
+        y.store(0, std::memory_order_relaxed);
+    }
+    template <Order O, Fence F>
+    void run(size_t thread) {
+        switch (thread) {
+        case 0:
+            x.store(1, kStoreOrder<O>);
+            break;
+        case 1:
+            y.store(1, kStoreOrder<O>);
+            break;
+        case 2:
+            r0 = x.load(kLoadOrder<O>);
+            prevent_reordering<F>();
+            r1 = y.load(kLoadOrder<O>);
+            break;
+        default:
+            r2 = y.load(kLoadOrder<O>);
+            prevent_reordering<F>();
+            r3 = x.load(kLoadOrder<O>);
+            break;
+        }
+    }
+    bool weak() const {
+        return r0 == 1 && r1 == 0 && r2 == 1 && r3 == 0;
+    }
+
+    std::atomic<int> x, y;
+    int r0 = 0, r1 = 0, r2 = 0, r3 = 0;
+};
+
+// 2+2W: each thread writes both variables in opposite orders. Both first writes surviving means each pair of
+// stores became visible out of order; the C++ model only forbids it for seq_cst or with thread fences, x86 never
+// shows it.
+struct TwoPlusTwoWrites {
+    static constexpr const char* kName = "2+2W";
+    static constexpr size_t kThreadCnt = 2;
+
+    void reset() {
+        x.store(0, std::memory_order_relaxed);
+        y.store(0, std::memory_order_relaxed);
+    }
+    template <Order O, Fence F>
+    void run(size_t thread) {
+        if (thread == 0) {
+            x.store(1, kStoreOrder<O>);
+            prevent_reordering<F>();
+            y.store(2, kStoreOrder<O>);
+        } else {
+            y.store(1, kStoreOrder<O>);
+            prevent_reordering<F>();
+            x.store(2, kStoreOrder<O>);
+        }
+    }
+    bool weak() const {
+        return x.load(std::memory_order_relaxed) == 1 && y.load(std::memory_order_relaxed) == 1;
+    }
+
+    std::atomic<int> x, y;
+};
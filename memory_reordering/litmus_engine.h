@@ -0,0 +1,133 @@
+#pragma once
+
+#include "cpu_utils.h"
+#include "litmus.h"
+
+#include <atomic>
+#include <barrier>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// Centralized sense-reversing barrier that spins instead of sleeping. The sense an arriving thread waits for
+// is derived from the global one, which can not flip before that thread has arrived. Long waits yield, so that
+// it still makes progress with more threads than CPUs.
+class SpinBarrier {
+public:
+    explicit SpinBarrier(size_t thread_cnt) : thread_cnt(thread_cnt), waiting(thread_cnt) {
+    }
+    void arrive_and_wait() {
+        const bool next_sense = !sense.load(std::memory_order_relaxed);
+        if (waiting.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            waiting.store(thread_cnt, std::memory_order_relaxed);
+            sense.store(next_sense, std::memory_order_release);
+            return;
+        }
+        for (size_t spins = 0; sense.load(std::memory_order_acquire) != next_sense; ++spins) {
+            if (spins >= kMaxSpins) {
+                std::this_thread::yield();
+            }
+        }
+    }
+private:
+    static constexpr size_t kMaxSpins = 1 << 16;
+
+    const size_t thread_cnt;
+    alignas(kCacheLineSize) std::atomic<size_t> waiting;
+    alignas(kCacheLineSize) std::atomic<bool> sense = false;
+};
+
+// The idx-th CPU the process may run on (wrapping around), so that the threads of a test run on different
+// cores. -1, i.e. unpinned, outside Linux.
+inline int nth_allowed_cpu(size_t idx) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return -1;
+    }
+    size_t skip = idx % CPU_COUNT(&allowed);
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && skip-- == 0) {
+            return cpu;
+        }
+    }
+#endif
+    return -1;
+}
+
+// Runs `iter_cnt` iterations of the test on Test::kThreadCnt threads that start each iteration together, and
+// returns how many of them ended with the weak outcome. Two std::barrier waits per iteration limit this to a
+// few hundred thousand iterations per second.
+template <typename Test, Order O, Fence F>
+size_t count_weak(size_t iter_cnt) {
+    Test test;
+    std::barrier sync(Test::kThreadCnt + 1);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < Test::kThreadCnt; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t iter = 0; iter < iter_cnt; ++iter) {
+                sync.arrive_and_wait();
+                test.template run<O, F>(t);
+                sync.arrive_and_wait();
+            }
+        });
+    }
+    size_t weak_cnt = 0;
+    for (size_t iter = 0; iter < iter_cnt; ++iter) {
+        test.reset();
+        sync.arrive_and_wait();
+        sync.arrive_and_wait();
+        weak_cnt += test.weak();
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return weak_cnt;
+}
+
+// Number of test instances count_weak_batched runs between two barriers.
+constexpr size_t kBatchSize = 10000;
+
+// Batched engine in the style of litmus7: every pinned thread runs its part of kBatchSize independent instances
+// of the test back to back, and the threads only meet at a SpinBarrier before and after each batch. Walking the
+// instances in the same order keeps the threads close enough that they race on the same instance. The outcomes
+// are tallied by the first thread after the batch, outside the racing part. `iter_cnt` must be a multiple of
+// kBatchSize.
+template <typename Test, Order O, Fence F>
+size_t count_weak_batched(size_t iter_cnt) {
+    const size_t batch_cnt = iter_cnt / kBatchSize;
+    const auto tests = std::make_unique<Test[]>(kBatchSize);
+    for (size_t i = 0; i < kBatchSize; ++i) {
+        tests[i].reset();
+    }
+    SpinBarrier sync(Test::kThreadCnt);
+    size_t weak_cnt = 0;
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < Test::kThreadCnt; ++t) {
+        threads.emplace_back([&, t]() {
+            const ScopedPin pin(nth_allowed_cpu(t));
+            for (size_t batch = 0; batch < batch_cnt; ++batch) {
+                sync.arrive_and_wait();
+                for (size_t i = 0; i < kBatchSize; ++i) {
+                    tests[i].template run<O, F>(t);
+                }
+                sync.arrive_and_wait();
+                if (t == 0) {
+                    for (size_t i = 0; i < kBatchSize; ++i) {
+                        weak_cnt += tests[i].weak();
+                        tests[i].reset();
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return weak_cnt;
+}
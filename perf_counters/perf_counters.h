@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware event counts for the benchmarks, read through perf_event_open. The counters follow the thread that
+// constructs the object and every thread it creates afterwards, so construct it before the benchmark starts its
+// threads. Events the kernel, the CPU or the container refuse (no PMU in a VM, perf_event_paranoid, seccomp)
+// are left out, and a benchmark without any events reports no counters instead of failing.
+//
+//     PerfCounters perf;
+//     ... set up, start threads ...
+//     perf.start();
+//     for (auto _ : state) { ... }
+//     perf.report(state);
+class PerfCounters {
+public:
+    PerfCounters() {
+#ifdef __linux__
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles");
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions");
+        open(PERF_TYPE_HW_CACHE,
+             PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+             "l1d_misses");
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "llc_misses");
+        open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch_misses");
+        // There is no generic event for loads served from a modified line in another core's cache. On Intel
+        // cores since Skylake it is MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM (XSNP_FWD on newer parts), elsewhere it
+        // is not counted.
+        if (cpu_vendor() == "GenuineIntel") {
+            open(PERF_TYPE_RAW, 0x04d2, "hitm");
+        }
+        if (events.empty()) {
+            warn_unavailable();
+        }
+#endif
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+    ~PerfCounters() {
+#ifdef __linux__
+        for (const auto& event : events) {
+            close(event.fd);
+        }
+#endif
+    }
+
+    bool available() const {
+        return !events.empty();
+    }
+    // Zeroes and enables the counters, usually right before the benchmark loop.
+    void start() {
+#ifdef __linux__
+        for (const auto& event : events) {
+            ioctl(event.fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(event.fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    // Stops counting and adds every event as a per-iteration counter, plus instructions per cycle.
+    void report(benchmark::State& state) {
+        double cycles = 0;
+        double instructions = 0;
+        for (const auto& event : events) {
+            const double count = stop_and_read(event);
+            state.counters[event.name] = benchmark::Counter(count, benchmark::Counter::kAvgIterations);
+            if (event.name == "cycles") {
+                cycles = count;
+            } else if (event.name == "instructions") {
+                instructions = count;
+            }
+        }
+        if (cycles > 0 && instructions > 0) {
+            // Averaged rather than summed when every thread of a ->Threads() benchmark reports.
+            state.counters["ipc"] = benchmark::Counter(instructions / cycles, benchmark::Counter::kAvgThreads);
+        }
+    }
+
+private:
+    struct Event {
+        int fd;
+        std::string name;
+    };
+
+#ifdef __linux__
+    // Opens a disabled counter for user-space execution of the calling thread and its future children.
+    void open(uint32_t type, uint64_t config, const char* name) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fd >= 0) {
+            events.push_back({fd, name});
+        } else if (error.empty()) {
+            error = std::string(name) + ": " + std::strerror(errno);
+        }
+    }
+
+    // The count is scaled up if the kernel had to multiplex the event with others.
+    static double stop_and_read(const Event& event) {
+        ioctl(event.fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t values[3] = {};
+        if (read(event.fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+            return 0;
+        }
+        return static_cast<double>(values[0]) * values[1] / values[2];
+    }
+
+    static std::string cpu_vendor() {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for (std::string line; std::getline(cpuinfo, line); ) {
+            if (line.starts_with("vendor_id")) {
+                return line.substr(line.find_last_of(" \t") + 1);
+            }
+        }
+        return "";
+    }
+
+    // Printed once per process rather than for every benchmark.
+    void warn_unavailable() const {
+        static bool warned = false;
+        if (!warned) {
+            warned = true;
+            std::cerr << "Hardware counters are unavailable (" << error << "), reporting timings only" << std::endl;
+        }
+    }
+
+    std::string error;
+#else
+    static double stop_and_read(const Event&) {
+        return 0;
+    }
+#endif
+
+    std::vector<Event> events;
+};
@@ -1,23 +1,31 @@
 #include "solution.h"
 
+#include "perf_counters.h"
+
 #include <benchmark/benchmark.h>
 
 namespace {
 
 void bench_ref(benchmark::State& state) {
+  PerfCounters perf;
   const auto input = init1();
   auto sol = reference_solution();
+  perf.start();
   for (auto _ : state) {
     benchmark::DoNotOptimize(sol->process(input, kWidth, kHeight, kRemove));
   }
+  perf.report(state);
 }
 
 void bench_sol(benchmark::State& state) {
+  PerfCounters perf;
   const auto input = init1();
   auto sol = solution();
+  perf.start();
   for (auto _ : state) {
     benchmark::DoNotOptimize(sol->process(input, kWidth, kHeight, kRemove));
   }
+  perf.report(state);
 }
 
 }  // namespace
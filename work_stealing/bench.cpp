@@ -0,0 +1,127 @@
+#include "perf_counters.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr size_t kElemCnt = 1 << 20;
+constexpr size_t kGrain = 256;
+constexpr int kFibN = 25;
+constexpr int kFibCutoff = 10;
+
+const int kMaxThreads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+// A few nanoseconds of work per index, so that scheduling overhead dominates with small grains.
+float body(size_t i) {
+    return std::sqrt(static_cast<float>(i)) * 0.5f + 1.0f;
+}
+
+uint64_t fib_serial(int n) {
+    return n < 2 ? n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+uint64_t fib_pool(ThreadPool& pool, int n) {
+    if (n < kFibCutoff) {
+        return fib_serial(n);
+    }
+    uint64_t a;
+    TaskGroup group(pool);
+    group.spawn([&]() {
+        a = fib_pool(pool, n - 1);
+    });
+    const uint64_t b = fib_pool(pool, n - 2);
+    group.sync();
+    return a + b;
+}
+
+uint64_t fib_async(int n) {
+    if (n < kFibCutoff) {
+        return fib_serial(n);
+    }
+    auto a = std::async(std::launch::async, fib_async, n - 1);
+    const uint64_t b = fib_async(n - 2);
+    return a.get() + b;
+}
+
+} // namespace
+
+// kElemCnt / kGrain fine-grained chunks on state.range(0) workers.
+void bench_parallel_for_pool(benchmark::State& state) {
+    PerfCounters perf;
+    ThreadPool pool(state.range(0));
+    std::vector<float> out(kElemCnt);
+    perf.start();
+    for (auto _ : state) {
+        pool.parallel_for(0, kElemCnt, kGrain, [&](size_t i) {
+            out[i] = body(i);
+        });
+        benchmark::DoNotOptimize(out.data());
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+}
+
+// The same chunks, one std::async each, at most state.range(0) in flight.
+void bench_parallel_for_async(benchmark::State& state) {
+    PerfCounters perf;
+    const size_t thread_cnt = state.range(0);
+    std::vector<float> out(kElemCnt);
+    perf.start();
+    for (auto _ : state) {
+        std::vector<std::future<void>> futures;
+        for (size_t begin = 0; begin < kElemCnt; begin += kGrain) {
+            if (futures.size() == thread_cnt) {
+                futures.front().wait();
+                futures.erase(futures.begin());
+            }
+            futures.push_back(std::async(std::launch::async, [&out, begin]() {
+                for (size_t i = begin; i < begin + kGrain; ++i) {
+                    out[i] = body(i);
+                }
+            }));
+        }
+        for (auto& future : futures) {
+            future.wait();
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    perf.report(state);
+    state.SetItemsProcessed(state.iterations() * kElemCnt);
+}
+
+BENCHMARK(bench_parallel_for_pool)->DenseRange(1, kMaxThreads)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_parallel_for_async)->DenseRange(1, kMaxThreads)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+// Recursive fork/join: one task per fib call above kFibCutoff.
+void bench_fib_pool(benchmark::State& state) {
+    PerfCounters perf;
+    ThreadPool pool(state.range(0));
+    perf.start();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fib_pool(pool, kFibN));
+    }
+    perf.report(state);
+}
+
+// The same recursion with a std::async per spawn; the thread count is not bounded, so it runs once.
+void bench_fib_async(benchmark::State& state) {
+    PerfCounters perf;
+    perf.start();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(fib_async(kFibN));
+    }
+    perf.report(state);
+}
+
+BENCHMARK(bench_fib_pool)->DenseRange(1, kMaxThreads)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+BENCHMARK(bench_fib_async)->Iterations(1)->Unit(benchmark::kMillisecond)->UseRealTime()->MeasureProcessCPUTime();
+
+BENCHMARK_MAIN();
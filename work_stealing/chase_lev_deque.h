@@ -0,0 +1,115 @@
+#pragma once
+
+#include "cpu_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+// Chase-Lev work-stealing deque ("Dynamic Circular Work-Stealing Deque", with the C11 memory orders from
+// Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+// The owner thread pushes and pops at the bottom (LIFO), any other thread steals from the top (FIFO).
+// Only the owner's pop and the thieves race for the last element, through a CAS on top.
+// The array grows when full; old arrays are kept until the deque is destroyed because a thief may still be
+// reading from one, which costs at most as much memory as the current array.
+template <typename T>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "ChaseLevDeque elements are copied racily, use pointers or indices");
+public:
+    explicit ChaseLevDeque(size_t capacity = 256) {
+        arrays.push_back(std::make_unique<Array>(std::bit_ceil(std::max<size_t>(capacity, 2))));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+    ChaseLevDeque(const ChaseLevDeque&) = delete;
+    ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+    // Owner only.
+    void push(T val) {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->mask)) {
+            a = grow(a, t, b);
+        }
+        a->store(b, val);
+        // Publishes the element to thieves (Le et al. use a release fence and a relaxed store).
+        bottom.store(b + 1, std::memory_order_release);
+    }
+    // Owner only: takes the most recently pushed element.
+    std::optional<T> pop() {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        std::optional<T> res = a->load(b);
+        if (t == b) {
+            // Last element: race the thieves for it.
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                res.reset();
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return res;
+    }
+    // Any thread: takes the oldest element. Returns std::nullopt if the deque is empty or another thread took
+    // the element first.
+    std::optional<T> steal() {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return std::nullopt;
+        }
+        Array* a = array.load(std::memory_order_acquire);
+        const T val = a->load(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return val;
+    }
+    // Approximate when called by a thief.
+    bool empty() const {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        explicit Array(size_t size) : mask(size - 1), items(std::make_unique<std::atomic<T>[]>(size)) {
+        }
+        T load(int64_t idx) const {
+            return items[idx & mask].load(std::memory_order_relaxed);
+        }
+        void store(int64_t idx, T val) {
+            items[idx & mask].store(val, std::memory_order_relaxed);
+        }
+        const size_t mask;
+        const std::unique_ptr<std::atomic<T>[]> items;
+    };
+
+    Array* grow(Array* a, int64_t t, int64_t b) {
+        arrays.push_back(std::make_unique<Array>(2 * (a->mask + 1)));
+        Array* bigger = arrays.back().get();
+        for (int64_t i = t; i < b; ++i) {
+            bigger->store(i, a->load(i));
+        }
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(kCacheLineSize) std::atomic<int64_t> top{0};
+    alignas(kCacheLineSize) std::atomic<int64_t> bottom{0};
+    std::atomic<Array*> array;
+    // Owned by the owner thread: the current array and all the ones it replaced.
+    std::vector<std::unique_ptr<Array>> arrays;
+};
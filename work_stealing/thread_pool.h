@@ -0,0 +1,279 @@
+#pragma once
+
+#include "chase_lev_deque.h"
+#include "cpu_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+// A set of tasks spawned into a ThreadPool that can be waited for together. sync() does not block the thread:
+// it runs queued tasks (its own first) until every task of the group has finished, so tasks may spawn and sync
+// nested groups without deadlocking the pool. The first exception thrown by a task is rethrown by sync().
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool) : pool(pool) {
+    }
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+    // Tasks may reference the group's stack frame, so it can not go away before they are done.
+    ~TaskGroup() {
+        wait();
+    }
+    template <typename F>
+    void spawn(F&& f);
+    void sync() {
+        wait();
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+
+private:
+    friend class ThreadPool;
+    void wait();
+    void finish(std::exception_ptr task_error) {
+        if (task_error && !failed.exchange(true, std::memory_order_relaxed)) {
+            error = std::move(task_error);
+        }
+        pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    ThreadPool& pool;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;
+};
+
+// Fork/join thread pool. Every worker owns a ChaseLevDeque: tasks it spawns go to the bottom of its own deque
+// and are popped LIFO, which keeps the working set hot in its cache, while idle workers steal the oldest (and
+// usually largest) tasks from the top of a random victim. Tasks spawned from outside the pool go through a
+// shared injection queue. Workers that find nothing to do spin briefly and then park.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_cnt = std::thread::hardware_concurrency()) {
+        thread_cnt = std::max<size_t>(thread_cnt, 1);
+        for (size_t i = 0; i < thread_cnt; ++i) {
+            workers.push_back(std::make_unique<Worker>(this, i));
+        }
+        for (auto& worker : workers) {
+            worker->thread = std::thread([this, w = worker.get()]() { run_worker(w); });
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool() {
+        stop.store(true, std::memory_order_seq_cst);
+        wake_epoch.fetch_add(1, std::memory_order_seq_cst);
+        wake_epoch.notify_all();
+        for (auto& worker : workers) {
+            worker->thread.join();
+        }
+    }
+
+    size_t thread_cnt() const {
+        return workers.size();
+    }
+    // Calls f(i) for every i in [begin, end). The range is split in halves recursively down to `grain`
+    // indices, so that thieves take large chunks and the owner works through small ones.
+    template <typename F>
+    void parallel_for(size_t begin, size_t end, size_t grain, F f) {
+        TaskGroup group(*this);
+        split(group, begin, end, std::max<size_t>(grain, 1), f);
+        group.sync();
+    }
+
+private:
+    friend class TaskGroup;
+
+    class Task {
+    public:
+        explicit Task(TaskGroup& group) : group(group) {
+        }
+        virtual ~Task() = default;
+        virtual void run() = 0;
+        TaskGroup& group;
+    };
+    template <typename F>
+    class FunctionTask : public Task {
+    public:
+        FunctionTask(TaskGroup& group, F f) : Task(group), f(std::move(f)) {
+        }
+        void run() override {
+            f();
+        }
+    private:
+        F f;
+    };
+
+    struct Worker {
+        Worker(ThreadPool* pool, size_t index) : pool(pool), index(index), rng(index * 0x9E37'79B9'7F4A'7C15 + 1) {
+        }
+        ThreadPool* const pool;
+        const size_t index;
+        uint64_t rng;
+        ChaseLevDeque<Task*> deque;
+        std::thread thread;
+    };
+
+    // The worker of this pool the calling thread is, or nullptr for outside threads.
+    Worker* current_worker() const {
+        return current != nullptr && current->pool == this ? current : nullptr;
+    }
+
+    void schedule(Task* task) {
+        if (Worker* self = current_worker()) {
+            self->deque.push(task);
+        } else {
+            const std::lock_guard lock(injection_mutex);
+            injection.push_back(task);
+            injected_cnt.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Pairs with the fence in park(): either the sleeper sees the task or we see the sleeper.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleepers.load(std::memory_order_relaxed) != 0) {
+            wake_epoch.fetch_add(1, std::memory_order_relaxed);
+            wake_epoch.notify_one();
+        }
+    }
+
+    Task* find_task(Worker* self) {
+        if (self != nullptr) {
+            if (const auto task = self->deque.pop()) {
+                return *task;
+            }
+        }
+        if (injected_cnt.load(std::memory_order_relaxed) != 0) {
+            const std::lock_guard lock(injection_mutex);
+            if (!injection.empty()) {
+                Task* task = injection.front();
+                injection.pop_front();
+                injected_cnt.fetch_sub(1, std::memory_order_relaxed);
+                return task;
+            }
+        }
+        // Start at a random victim so that thieves spread over the workers.
+        thread_local uint64_t outside_rng = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        uint64_t& rng = self != nullptr ? self->rng : outside_rng;
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        const size_t start = rng % workers.size();
+        for (size_t i = 0; i < workers.size(); ++i) {
+            Worker* victim = workers[(start + i) % workers.size()].get();
+            if (victim == self) {
+                continue;
+            }
+            if (const auto task = victim->deque.steal()) {
+                return *task;
+            }
+        }
+        return nullptr;
+    }
+    static void execute(Task* task) {
+        std::exception_ptr task_error;
+        try {
+            task->run();
+        } catch (...) {
+            task_error = std::current_exception();
+        }
+        TaskGroup& group = task->group;
+        delete task;
+        group.finish(std::move(task_error));
+    }
+    bool run_one(Worker* self) {
+        Task* task = find_task(self);
+        if (task == nullptr) {
+            return false;
+        }
+        execute(task);
+        return true;
+    }
+
+    void run_worker(Worker* self) {
+        current = self;
+        constexpr int kSpinCnt = 64;
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (run_one(self)) {
+                continue;
+            }
+            bool found = false;
+            for (int i = 0; i < kSpinCnt && !found; ++i) {
+                cpu_relax();
+                found = run_one(self);
+            }
+            if (!found) {
+                park(self);
+            }
+        }
+        current = nullptr;
+    }
+    void park(Worker* self) {
+        const uint32_t epoch = wake_epoch.load(std::memory_order_relaxed);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        if (Task* task = find_task(self)) {
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            execute(task);
+            return;
+        }
+        if (!stop.load(std::memory_order_seq_cst)) {
+            wake_epoch.wait(epoch, std::memory_order_relaxed);
+        }
+        sleepers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    template <typename F>
+    void split(TaskGroup& group, size_t begin, size_t end, size_t grain, const F& f) {
+        while (end - begin > grain) {
+            const size_t mid = begin + (end - begin) / 2;
+            group.spawn([this, &group, mid, end, grain, &f]() {
+                split(group, mid, end, grain, f);
+            });
+            end = mid;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            f(i);
+        }
+    }
+
+    static inline thread_local Worker* current = nullptr;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex injection_mutex;
+    std::deque<Task*> injection;
+    alignas(kCacheLineSize) std::atomic<size_t> injected_cnt{0};
+    alignas(kCacheLineSize) std::atomic<uint32_t> wake_epoch{0};
+    std::atomic<uint32_t> sleepers{0};
+    std::atomic<bool> stop{false};
+};
+
+template <typename F>
+void TaskGroup::spawn(F&& f) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    pool.schedule(new ThreadPool::FunctionTask<std::decay_t<F>>(*this, std::forward<F>(f)));
+}
+
+inline void TaskGroup::wait() {
+    ThreadPool::Worker* self = pool.current_worker();
+    while (pending.load(std::memory_order_acquire) != 0) {
+        if (!pool.run_one(self)) {
+            // The remaining tasks are running elsewhere.
+            if (self != nullptr) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#include "chase_lev_deque.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <barrier>
+#include <cstdint>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr int kElemCnt = 12345;
+
+// The owner pushes kElemCnt values and pops some of them back while thief_cnt threads steal;
+// every value has to be taken exactly once.
+bool validate_deque(size_t thief_cnt, size_t test_cnt) {
+    for (int t = 0; t < test_cnt; ++t) {
+        // Small initial capacity, so that the owner grows the array while thieves read from it.
+        ChaseLevDeque<int> deque(2);
+        std::atomic<bool> done = false;
+        std::barrier sync(thief_cnt + 1);
+        std::vector<std::vector<int>> taken(thief_cnt + 1);
+        std::vector<std::future<void>> futures;
+        for (size_t i = 1; i <= thief_cnt; ++i) {
+            futures.push_back(std::async(std::launch::async, [&, i]() {
+                sync.arrive_and_wait();
+                while (!done.load() || !deque.empty()) {
+                    if (const auto val = deque.steal()) {
+                        taken[i].push_back(*val);
+                    }
+                }
+            }));
+        }
+        sync.arrive_and_wait();
+        for (int i = 0; i < kElemCnt; ++i) {
+            deque.push(i);
+            if (i % 3 == 0) {
+                if (const auto val = deque.pop()) {
+                    taken[0].push_back(*val);
+                }
+            }
+        }
+        while (const auto val = deque.pop()) {
+            taken[0].push_back(*val);
+        }
+        done.store(true);
+        for (auto& future : futures) {
+            future.get();
+        }
+        std::vector<int> seen(kElemCnt);
+        for (const auto& vals : taken) {
+            for (const int val : vals) {
+                ++seen[val];
+            }
+        }
+        for (int i = 0; i < kElemCnt; ++i) {
+            if (seen[i] != 1) {
+                std::cerr << "Error (deque): value " << i << " taken " << seen[i] << " times, round " << t << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool validate_parallel_for(ThreadPool& pool, size_t test_cnt) {
+    for (int t = 0; t < test_cnt; ++t) {
+        std::vector<int> visits(kElemCnt);
+        pool.parallel_for(0, kElemCnt, 1 + t % 64, [&](size_t i) {
+            ++visits[i];
+        });
+        for (int i = 0; i < kElemCnt; ++i) {
+            if (visits[i] != 1) {
+                std::cerr << "Error (parallel_for): index " << i << " visited " << visits[i] << " times, round " << t << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t fib(ThreadPool& pool, int n) {
+    if (n < 2) {
+        return n;
+    }
+    uint64_t a;
+    uint64_t b;
+    TaskGroup group(pool);
+    group.spawn([&]() {
+        a = fib(pool, n - 1);
+    });
+    b = fib(pool, n - 2);
+    group.sync();
+    return a + b;
+}
+
+// Deeply nested spawn/sync, entered from outside the pool and from several threads at once.
+bool validate_spawn_sync(ThreadPool& pool, size_t test_cnt) {
+    constexpr int kN = 20;
+    constexpr uint64_t kExpected = 6765;
+    for (int t = 0; t < test_cnt; ++t) {
+        std::vector<std::future<uint64_t>> futures;
+        for (int i = 0; i < 3; ++i) {
+            futures.push_back(std::async(std::launch::async, [&]() {
+                return fib(pool, kN);
+            }));
+        }
+        for (auto& future : futures) {
+            const uint64_t res = future.get();
+            if (res != kExpected) {
+                std::cerr << "Error (spawn/sync): fib(" << kN << ") = " << res << ", expected " << kExpected << ", round " << t << "\n";
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool validate_exception(ThreadPool& pool) {
+    std::atomic<int> completed = 0;
+    try {
+        pool.parallel_for(0, kElemCnt, 16, [&](size_t i) {
+            if (i == kElemCnt / 2) {
+                throw std::runtime_error("task failed");
+            }
+            ++completed;
+        });
+    } catch (const std::runtime_error&) {
+        // Only the rest of the failing leaf chunk is skipped.
+        if (completed.load() < kElemCnt - 16 || completed.load() >= kElemCnt) {
+            std::cerr << "Error (exception): " << completed.load() << " of " << kElemCnt << " indices completed\n";
+            return false;
+        }
+        return true;
+    }
+    std::cerr << "Error (exception): exception was not propagated\n";
+    return false;
+}
+
+} // namespace
+
+int main() {
+    constexpr size_t kTestCnt = 100;
+    bool ok = true;
+    for (const size_t thief_cnt : {1, 3}) {
+        std::cout << "Validating ChaseLevDeque with " << thief_cnt << " thieves\n";
+        ok &= validate_deque(thief_cnt, kTestCnt);
+    }
+    for (const size_t thread_cnt : {1, 4}) {
+        ThreadPool pool(thread_cnt);
+        std::cout << "Validating ThreadPool with " << thread_cnt << " threads\n";
+        ok &= validate_parallel_for(pool, kTestCnt);
+        ok &= validate_spawn_sync(pool, kTestCnt / 10);
+        ok &= validate_exception(pool);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}